@@ -0,0 +1,191 @@
+#include "artifact_cache.h"
+#include "graph.pb.h"
+#include "transport_catalogue.pb.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <vector>
+
+namespace artifact_cache {
+namespace {
+
+// part of every key, bump it when an encoding or the way an artifact is built changes
+constexpr uint64_t kCacheVersion = 2;
+
+} // namespace
+
+ArtifactCache::ArtifactCache(std::filesystem::path dir)
+	: dir_(std::move(dir)) {
+}
+
+bool ArtifactCache::IsEnabled() const {
+	return !dir_.empty();
+}
+
+std::optional<std::string> ArtifactCache::Load(std::string_view kind, uint64_t key) const {
+	if (!IsEnabled()) {
+		return std::nullopt;
+	}
+	std::ifstream input(GetPath(kind, key), std::ios::binary);
+	if (!input) {
+		return std::nullopt;
+	}
+	return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+void ArtifactCache::Store(std::string_view kind, uint64_t key, std::string_view data) const {
+	if (!IsEnabled()) {
+		return;
+	}
+	// the cache only saves time, so a failure to write it is not an error
+	std::error_code error;
+	std::filesystem::create_directories(dir_, error);
+	const std::filesystem::path path = GetPath(kind, key);
+	std::filesystem::path temp_path = path;
+	temp_path += ".tmp";
+	{
+		std::ofstream output(temp_path, std::ios::binary);
+		output.write(data.data(), data.size());
+		if (!output) {
+			std::filesystem::remove(temp_path, error);
+			return;
+		}
+	}
+	std::filesystem::rename(temp_path, path, error);
+}
+
+std::filesystem::path ArtifactCache::GetPath(std::string_view kind, uint64_t key) const {
+	char name[17];
+	std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key ^ kCacheVersion));
+	return dir_ / (std::string(kind) + "-" + name);
+}
+
+std::string EncodeBusesInfo(const data_base::TransportCatalogue& tc) {
+	db_proto::BusesInfo buses_info;
+	const data_base::TransportCatalogue::AllBusesInfo& all_buses_info = tc.GetAllBusesInfo();
+	buses_info.mutable_info()->Reserve(all_buses_info.size());
+	for (const domain::BusInfo& bus_info : all_buses_info) {
+		db_proto::BusInfo* info_proto = buses_info.add_info();
+		info_proto->set_unique_stops(bus_info.unique_stops);
+		info_proto->set_count_stops(bus_info.count_stops);
+		info_proto->set_geo_length(bus_info.geo_length);
+		info_proto->set_real_length(bus_info.real_length);
+		info_proto->set_curvature(bus_info.curvature);
+	}
+	return buses_info.SerializeAsString();
+}
+
+bool DecodeBusesInfo(std::string_view data, data_base::TransportCatalogue& tc) {
+	db_proto::BusesInfo buses_info;
+	if (!buses_info.ParseFromArray(data.data(), data.size())) {
+		return false;
+	}
+	const data_base::TransportCatalogue::AllBuses buses = tc.GetAllBuses();
+	if (static_cast<size_t>(buses_info.info_size()) != buses.size()) {
+		return false;
+	}
+	for (const domain::Bus& bus : buses) {
+		if (bus.route_size == 0) {
+			continue;
+		}
+		const db_proto::BusInfo& info_proto = buses_info.info(bus.id);
+		domain::BusInfo bus_info;
+		bus_info.bus = tc.FindBus(bus.bus_name);
+		bus_info.unique_stops = info_proto.unique_stops();
+		bus_info.count_stops = info_proto.count_stops();
+		bus_info.geo_length = info_proto.geo_length();
+		bus_info.real_length = info_proto.real_length();
+		bus_info.curvature = info_proto.curvature();
+		tc.SetBusInfo(bus_info);
+	}
+	return true;
+}
+
+std::string EncodeRouter(const data_base::TransportCatalogue& tc, const graph::Router<double>& router) {
+	const graph::DirectedWeightedGraph<double>& graph = router.GetGraph();
+	db_proto::RouterTables tables;
+	tables.set_vertex_count(graph.GetVertexCount());
+	tables.mutable_edges()->Reserve(graph.GetEdgeCount());
+	for (graph::EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+		const graph::Edge<double>& edge = graph.GetEdge(edge_id);
+		db_proto::GraphEdge* edge_proto = tables.add_edges();
+		edge_proto->set_from(edge.from);
+		edge_proto->set_to(edge.to);
+		edge_proto->set_weight(edge.weight);
+		edge_proto->set_span_count(edge.span_count);
+		if (edge.type == graph::EdgeType::Walk) {
+			edge_proto->set_is_walk(true);
+		} else {
+			edge_proto->set_bus_id(tc.FindBus(tc.GetName(edge.bus_name_id))->id);
+		}
+	}
+	const size_t vertex_count = graph.GetVertexCount();
+	tables.mutable_prev_edges()->Reserve(vertex_count * vertex_count);
+	for (const auto& row : router.GetRoutesInternalData()) {
+		for (const auto& route : row) {
+			if (!route) {
+				tables.add_prev_edges(0);
+				continue;
+			}
+			tables.add_prev_edges(route->prev_edge ? *route->prev_edge + 2 : 1);
+			tables.add_weights(route->weight);
+		}
+	}
+	return tables.SerializeAsString();
+}
+
+std::optional<graph::Router<double>::RoutesInternalData>
+DecodeRouter(std::string_view data, const data_base::TransportCatalogue& tc, graph::DirectedWeightedGraph<double>& graph) {
+	db_proto::RouterTables tables;
+	if (!tables.ParseFromArray(data.data(), data.size())) {
+		return std::nullopt;
+	}
+	const size_t vertex_count = tables.vertex_count();
+	const size_t edge_count = tables.edges_size();
+	if (vertex_count != tc.GetStopCounts()
+		|| static_cast<size_t>(tables.prev_edges_size()) != vertex_count * vertex_count) {
+		return std::nullopt;
+	}
+	const data_base::TransportCatalogue::AllBuses buses = tc.GetAllBuses();
+	for (const db_proto::GraphEdge& edge_proto : tables.edges()) {
+		if (edge_proto.from() >= vertex_count || edge_proto.to() >= vertex_count
+			|| (!edge_proto.is_walk() && edge_proto.bus_id() >= buses.size())) {
+			return std::nullopt;
+		}
+	}
+
+	graph::Router<double>::RoutesInternalData routes(vertex_count);
+	size_t weight_index = 0;
+	for (size_t from = 0; from < vertex_count; ++from) {
+		routes[from].resize(vertex_count);
+		for (size_t to = 0; to < vertex_count; ++to) {
+			const uint64_t prev_edge = tables.prev_edges(from * vertex_count + to);
+			if (prev_edge == 0) {
+				continue;
+			}
+			const bool has_edge = prev_edge > 1;
+			if (weight_index == static_cast<size_t>(tables.weights_size()) || (has_edge && prev_edge - 2 >= edge_count)) {
+				return std::nullopt;
+			}
+			routes[from][to] = graph::Router<double>::RouteInternalData{
+				tables.weights(weight_index++),
+				has_edge ? std::optional<graph::EdgeId>(prev_edge - 2) : std::nullopt};
+		}
+	}
+
+	graph = graph::DirectedWeightedGraph<double>(vertex_count);
+	for (const db_proto::GraphEdge& edge_proto : tables.edges()) {
+		graph::Edge<double> edge {edge_proto.from(), edge_proto.to(), edge_proto.weight(), edge_proto.span_count(), {}};
+		if (edge_proto.is_walk()) {
+			edge.type = graph::EdgeType::Walk;
+		} else {
+			edge.bus_name_id = buses[edge_proto.bus_id()].name_id;
+		}
+		graph.AddEdge(edge);
+	}
+	return routes;
+}
+
+} // namespace artifact_cache
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace artifact_cache {
+
+// directory of derived data, a file per artifact named by its kind and the hash
+// of everything it is computed from, so a changed input simply misses the cache;
+// a cache without a directory is disabled and never hits
+class ArtifactCache {
+public:
+	ArtifactCache() = default;
+	explicit ArtifactCache(std::filesystem::path dir);
+
+	bool IsEnabled() const;
+	std::optional<std::string> Load(std::string_view kind, uint64_t key) const;
+	// the file is written under a temporary name and renamed, so readers never see a partial one
+	void Store(std::string_view kind, uint64_t key, std::string_view data) const;
+
+private:
+	std::filesystem::path dir_;
+
+	std::filesystem::path GetPath(std::string_view kind, uint64_t key) const;
+};
+
+// decoders return false or nullopt if the data does not fit the catalogue
+std::string EncodeBusesInfo(const data_base::TransportCatalogue& tc);
+bool DecodeBusesInfo(std::string_view data, data_base::TransportCatalogue& tc);
+
+std::string EncodeRouter(const data_base::TransportCatalogue& tc, const graph::Router<double>& router);
+// fills the empty graph and returns the tables of the router over it
+std::optional<graph::Router<double>::RoutesInternalData>
+DecodeRouter(std::string_view data, const data_base::TransportCatalogue& tc, graph::DirectedWeightedGraph<double>& graph);
+
+} // namespace artifact_cache
@@ -0,0 +1,76 @@
+#include "content_hash.h"
+
+namespace content_hash {
+namespace {
+
+uint64_t Mix(uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+} // namespace
+
+Hasher& Hasher::Add(std::string_view bytes) {
+	// the size keeps adjacent strings apart
+	AddValue(static_cast<uint64_t>(bytes.size()));
+	return AddBytes(bytes);
+}
+
+Hasher& Hasher::AddBytes(std::string_view bytes) {
+	for (const char c : bytes) {
+		state_ ^= static_cast<unsigned char>(c);
+		state_ *= 0x100000001b3ULL;
+	}
+	return *this;
+}
+
+uint64_t Hasher::GetHash() const {
+	return Mix(state_);
+}
+
+uint64_t HashCatalogue(const data_base::TransportCatalogue& tc) {
+	Hasher hasher;
+	hasher.AddValue(static_cast<uint64_t>(tc.GetStopCounts()));
+	for (size_t id = 0; id < tc.GetStopCounts(); ++id) {
+		const domain::Stop* stop = tc.FindStopById(id);
+		const geo::Coordinates coordinates = tc.GetStopStore().GetCoordinates(id);
+		hasher.Add(stop->stop_name).AddValue(coordinates.lat).AddValue(coordinates.lng);
+	}
+	const data_base::TransportCatalogue::AllBuses buses = tc.GetAllBuses();
+	hasher.AddValue(static_cast<uint64_t>(buses.size()));
+	for (const domain::Bus& bus : buses) {
+		const data_base::TransportCatalogue::Route route = tc.GetRoute(bus);
+		hasher.Add(bus.bus_name).AddValue(bus.route_type).AddValue(static_cast<uint64_t>(route.size()));
+		for (const uint32_t stop_id : route) {
+			hasher.AddValue(stop_id);
+		}
+	}
+	// distances are kept in a hash map, so they are combined regardless of the order
+	const data_base::TransportCatalogue::Distances& distances = *tc.GetAllDistances();
+	uint64_t distances_hash = 0;
+	for (const auto& [from_to, length] : distances) {
+		distances_hash += Hasher{}.AddValue(from_to.first->id).AddValue(from_to.second->id).AddValue(length).GetHash();
+	}
+	hasher.AddValue(static_cast<uint64_t>(distances.size())).AddValue(distances_hash);
+	return hasher.GetHash();
+}
+
+uint64_t HashRenderSettings(const renderer::RenderSettings& rs) {
+	Hasher hasher;
+	hasher.AddValue(rs.width).AddValue(rs.height).AddValue(rs.padding)
+		.AddValue(rs.line_width).AddValue(rs.stop_radius)
+		.AddValue(rs.bus_label_font_size).AddValue(rs.bus_label_offset.x).AddValue(rs.bus_label_offset.y)
+		.AddValue(rs.stop_label_font_size).AddValue(rs.stop_label_offset.x).AddValue(rs.stop_label_offset.y)
+		.Add(rs.underlayer_color).AddValue(rs.underlayer_width)
+		.AddValue(static_cast<uint64_t>(rs.color_palette.size()));
+	for (const svg::Color& color : rs.color_palette) {
+		hasher.Add(color);
+	}
+	return hasher.GetHash();
+}
+
+} // namespace content_hash
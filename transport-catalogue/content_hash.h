@@ -0,0 +1,38 @@
+#pragma once
+
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace content_hash {
+
+// 64-bit hash of a sequence of values, stable between runs, so it can key files on disk
+class Hasher {
+public:
+	Hasher& Add(std::string_view bytes);
+
+	template <typename T>
+	Hasher& AddValue(const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		char bytes[sizeof(T)];
+		std::memcpy(bytes, &value, sizeof(T));
+		return AddBytes({bytes, sizeof(T)});
+	}
+
+	uint64_t GetHash() const;
+
+private:
+	uint64_t state_ = 0xcbf29ce484222325ULL;
+
+	Hasher& AddBytes(std::string_view bytes);
+};
+
+// everything derived data is computed from: stops, distances and buses with their routes
+uint64_t HashCatalogue(const data_base::TransportCatalogue& tc);
+uint64_t HashRenderSettings(const renderer::RenderSettings& rs);
+
+} // namespace content_hash
@@ -1,15 +1,17 @@
 #pragma once
 #include "geo.h"
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace domain {
 
+// coordinates of a stop are kept by the catalogue's StopStore under the stop id
 struct Stop {
 	size_t id;
-	std::string stop_name;
-	geo::Coordinates coordinates;
+	std::string_view stop_name;
 };
 
 enum class RouteType {
@@ -18,8 +20,13 @@ enum class RouteType {
 };
 
 struct Bus {
-	std::string bus_name;
-	std::vector<Stop*> route_;
+	size_t id;
+	std::string_view bus_name;
+	// symbol id of bus_name in the catalogue's name arena
+	uint32_t name_id = 0;
+	// slice of the catalogue-wide array of route stop ids
+	uint32_t route_begin = 0;
+	uint32_t route_size = 0;
 	RouteType route_type;
 };
 
@@ -30,15 +37,26 @@ struct BusInfo {
 	double geo_length = 0;
 	double real_length = 0;
 	double curvature = 0;
-	std::string route_type;
 };
 
 struct StopInfo {
-	Stop* stop;
-	std::vector<std::string_view> buses_to_stop;
+	const Stop* stop;
+	// symbol ids of the bus names, sorted by name
+	std::vector<uint32_t> buses_to_stop;
 	bool no_bus;
 };
 
+struct StopDistance {
+	const Stop* stop;
+	double distance;
+};
+
+// serialized answer with the request id left out: head + request_id + tail
+struct ResponseFragment {
+	std::string head;
+	std::string tail;
+};
+
 //struct Distance {
 //    std::pair<const domain::Stop*, const domain::Stop*> from_to;
 //    size_t value = 0;
@@ -0,0 +1,324 @@
+#include "flat_base.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FLAT_BASE_MMAP
+#endif
+
+namespace serialization {
+namespace flat_base {
+namespace {
+
+using namespace std::literals;
+
+constexpr size_t kAlignment = 8;
+constexpr size_t kSectionCount = static_cast<size_t>(SectionId::Count);
+constexpr size_t kTablesBegin = sizeof(Header) + kSectionCount * sizeof(Section);
+
+static_assert(sizeof(Header) % kAlignment == 0 && sizeof(Section) % kAlignment == 0);
+
+// collects sections after the header and the table of sections
+class SectionsBuilder {
+public:
+	template <typename T>
+	void Add(SectionId id, const T* data, size_t count) {
+		body_.resize((body_.size() + kAlignment - 1) / kAlignment * kAlignment, '\0');
+		sections_[static_cast<size_t>(id)] = {kTablesBegin + body_.size(), count * sizeof(T)};
+		body_.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+	}
+
+	template <typename T>
+	void Add(SectionId id, const std::vector<T>& data) {
+		Add(id, data.data(), data.size());
+	}
+
+	void WriteTo(std::ostream& out, const Header& header) const {
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(sections_), sizeof(sections_));
+		out.write(body_.data(), body_.size());
+	}
+
+private:
+	Section sections_[kSectionCount] {};
+	std::string body_;
+};
+
+bool IsMonotonic(ranges::Range<const uint32_t*> offsets, size_t limit) {
+	return std::is_sorted(offsets.begin(), offsets.end())
+		   && (offsets.empty() || (offsets[0] == 0 && offsets[offsets.size() - 1] <= limit));
+}
+
+} // namespace
+
+bool IsFlatBase(const std::filesystem::path& path) {
+	std::ifstream input(path, std::ios::binary);
+	char magic[sizeof(kMagic)] {};
+	input.read(magic, sizeof(magic));
+	return input && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+void Write(const std::filesystem::path& path, const data_base::TransportCatalogue& tc,
+		   const db_proto::TC& settings) {
+	std::vector<Coordinates> coordinates;
+	std::vector<uint32_t> stop_name_offsets {0};
+	std::string names;
+	coordinates.reserve(tc.GetStopCounts());
+	stop_name_offsets.reserve(tc.GetStopCounts() + 1);
+	for (size_t id = 0; id < tc.GetStopCounts(); ++id) {
+		const domain::Stop* stop = tc.FindStopById(id);
+		const geo::Coordinates stop_coordinates = tc.GetStopStore().GetCoordinates(id);
+		coordinates.push_back({stop_coordinates.lat, stop_coordinates.lng});
+		names += stop->stop_name;
+		stop_name_offsets.push_back(names.size());
+	}
+
+	const data_base::TransportCatalogue::AllBuses buses = tc.GetAllBuses();
+	std::vector<uint32_t> bus_name_offsets {static_cast<uint32_t>(names.size())};
+	std::vector<uint8_t> route_types;
+	std::vector<uint32_t> route_offsets {0};
+	std::vector<uint32_t> route_stops;
+	std::vector<BusInfo> bus_infos;
+	for (const domain::Bus& bus : buses) {
+		names += bus.bus_name;
+		bus_name_offsets.push_back(names.size());
+		route_types.push_back(bus.route_type == domain::RouteType::Ring ? 1 : 0);
+		const data_base::TransportCatalogue::Route route = tc.GetRoute(bus);
+		route_stops.insert(route_stops.end(), route.begin(), route.end());
+		route_offsets.push_back(route_stops.size());
+		const domain::BusInfo bus_info = tc.GetBusInfo(bus);
+		bus_infos.push_back({static_cast<uint32_t>(bus_info.unique_stops), static_cast<uint32_t>(bus_info.count_stops),
+							 bus_info.geo_length, bus_info.real_length, bus_info.curvature});
+	}
+
+	std::vector<Distance> distances;
+	distances.reserve(tc.GetAllDistances()->size());
+	for (const auto& [from_to, length] : *tc.GetAllDistances()) {
+		distances.push_back({static_cast<uint32_t>(from_to.first->id), static_cast<uint32_t>(from_to.second->id), length});
+	}
+
+	const data_base::PerfectHash::Data& name_index = tc.GetNameIndex().GetData();
+	const std::string settings_data = settings.SerializeAsString();
+
+	SectionsBuilder builder;
+	builder.Add(SectionId::StopCoordinates, coordinates);
+	builder.Add(SectionId::StopNameOffsets, stop_name_offsets);
+	builder.Add(SectionId::BusNameOffsets, bus_name_offsets);
+	builder.Add(SectionId::Names, names.data(), names.size());
+	builder.Add(SectionId::BusRouteTypes, route_types);
+	builder.Add(SectionId::RouteOffsets, route_offsets);
+	builder.Add(SectionId::RouteStops, route_stops);
+	builder.Add(SectionId::BusInfos, bus_infos);
+	builder.Add(SectionId::Distances, distances);
+	builder.Add(SectionId::NameIndexPilots, name_index.pilots);
+	builder.Add(SectionId::NameIndexValues, name_index.values);
+	builder.Add(SectionId::NameIndexFingerprints, name_index.fingerprints);
+	builder.Add(SectionId::SpatialOrder, tc.GetSpatialIndex().GetOrder());
+	builder.Add(SectionId::Settings, settings_data.data(), settings_data.size());
+
+	Header header {};
+	std::memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.section_count = kSectionCount;
+	header.name_index_seed = name_index.seed;
+
+	std::ofstream out(path, std::ios::binary);
+	builder.WriteTo(out, header);
+}
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+#ifdef FLAT_BASE_MMAP
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::logic_error("Cannot open base file "s + path.string());
+	}
+	struct stat file_stat {};
+	if (fstat(fd, &file_stat) != 0) {
+		close(fd);
+		throw std::logic_error("Cannot open base file "s + path.string());
+	}
+	size_ = static_cast<size_t>(file_stat.st_size);
+	if (size_ > 0) {
+		void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			close(fd);
+			throw std::logic_error("Cannot map base file "s + path.string());
+		}
+		data_ = static_cast<const char*>(data);
+		is_mapped_ = true;
+	}
+	close(fd);
+#else
+	std::ifstream input(path, std::ios::binary);
+	if (!input) {
+		throw std::logic_error("Cannot open base file "s + path.string());
+	}
+	buffer_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+	data_ = buffer_.data();
+	size_ = buffer_.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef FLAT_BASE_MMAP
+	if (is_mapped_) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+#endif
+}
+
+std::string_view MappedFile::GetData() const {
+	return {data_, size_};
+}
+
+Reader::Reader(const std::filesystem::path& path)
+	: file_(path) {
+	const std::string_view data = file_.GetData();
+	if (data.size() < kTablesBegin) {
+		throw std::logic_error("Broken base file: too short"s);
+	}
+	header_ = reinterpret_cast<const Header*>(data.data());
+	sections_ = reinterpret_cast<const Section*>(data.data() + sizeof(Header));
+	Validate();
+}
+
+template <typename T>
+ranges::Range<const T*> Reader::GetSection(SectionId id) const {
+	const Section& section = sections_[static_cast<size_t>(id)];
+	const T* begin = reinterpret_cast<const T*>(file_.GetData().data() + section.offset);
+	return {begin, begin + section.size / sizeof(T)};
+}
+
+void Reader::SetDB(data_base::TransportCatalogue& tc) const {
+	const auto coordinates = GetSection<Coordinates>(SectionId::StopCoordinates);
+	const auto stop_name_offsets = GetSection<uint32_t>(SectionId::StopNameOffsets);
+	const auto bus_name_offsets = GetSection<uint32_t>(SectionId::BusNameOffsets);
+	const auto route_types = GetSection<uint8_t>(SectionId::BusRouteTypes);
+	const auto route_offsets = GetSection<uint32_t>(SectionId::RouteOffsets);
+	const auto route_stops = GetSection<uint32_t>(SectionId::RouteStops);
+	const auto bus_infos = GetSection<BusInfo>(SectionId::BusInfos);
+	const auto spatial_order = GetSection<uint32_t>(SectionId::SpatialOrder);
+
+	tc.ReserveNames(GetSection<char>(SectionId::Names).size());
+	tc.ReserveStops(coordinates.size());
+	tc.ReserveBuses(route_types.size(), route_stops.size());
+	tc.ReserveDistances(GetSection<Distance>(SectionId::Distances).size());
+	for (size_t id = 0; id < coordinates.size(); ++id) {
+		domain::Stop stop;
+		stop.id = id;
+		stop.stop_name = GetName(stop_name_offsets, id);
+		tc.AddStop(stop, {coordinates[id].lat, coordinates[id].lng});
+	}
+	tc.SetSpatialIndex({spatial_order.begin(), spatial_order.end()});
+
+	for (const Distance& distance : GetSection<Distance>(SectionId::Distances)) {
+		tc.SetDistances(tc.FindStopById(distance.from), tc.FindStopById(distance.to), distance.length);
+	}
+
+	for (size_t id = 0; id < route_types.size(); ++id) {
+		domain::Bus bus;
+		bus.bus_name = GetName(bus_name_offsets, id);
+		bus.route_type = route_types[id] == 1 ? domain::RouteType::Ring : domain::RouteType::Line;
+		tc.AddBus(bus, data_base::TransportCatalogue::Route{route_stops.begin() + route_offsets[id],
+															route_stops.begin() + route_offsets[id + 1]});
+		if (route_offsets[id] == route_offsets[id + 1]) {
+			continue;
+		}
+		domain::BusInfo bus_info;
+		bus_info.bus = tc.FindBus(bus.bus_name);
+		bus_info.unique_stops = bus_infos[id].unique_stops;
+		bus_info.count_stops = bus_infos[id].count_stops;
+		bus_info.geo_length = bus_infos[id].geo_length;
+		bus_info.real_length = bus_infos[id].real_length;
+		bus_info.curvature = bus_infos[id].curvature;
+		tc.SetBusInfo(bus_info);
+	}
+	tc.Finalize();
+
+	data_base::PerfectHash::Data name_index;
+	name_index.seed = header_->name_index_seed;
+	const auto pilots = GetSection<uint32_t>(SectionId::NameIndexPilots);
+	const auto values = GetSection<uint32_t>(SectionId::NameIndexValues);
+	const auto fingerprints = GetSection<uint32_t>(SectionId::NameIndexFingerprints);
+	name_index.pilots.assign(pilots.begin(), pilots.end());
+	name_index.values.assign(values.begin(), values.end());
+	name_index.fingerprints.assign(fingerprints.begin(), fingerprints.end());
+	tc.Freeze(std::move(name_index));
+}
+
+std::string_view Reader::GetSettings() const {
+	const auto settings = GetSection<char>(SectionId::Settings);
+	return {settings.begin(), settings.size()};
+}
+
+std::string_view Reader::GetName(ranges::Range<const uint32_t*> offsets, size_t index) const {
+	const auto names = GetSection<char>(SectionId::Names);
+	return {names.begin() + offsets[index], offsets[index + 1] - offsets[index]};
+}
+
+void Reader::Validate() const {
+	if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0) {
+		throw std::logic_error("Broken base file: not a flat base"s);
+	}
+	if (header_->version != kVersion || header_->section_count != kSectionCount) {
+		throw std::logic_error("Unsupported flat base version "s + std::to_string(header_->version));
+	}
+	const size_t file_size = file_.GetData().size();
+	const size_t element_sizes[kSectionCount] = {
+		sizeof(Coordinates), sizeof(uint32_t), sizeof(uint32_t), sizeof(char), sizeof(uint8_t),
+		sizeof(uint32_t), sizeof(uint32_t), sizeof(BusInfo), sizeof(Distance),
+		sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(char)
+	};
+	for (size_t i = 0; i < kSectionCount; ++i) {
+		const Section& section = sections_[i];
+		if (section.offset % kAlignment != 0 || section.offset > file_size
+			|| section.size > file_size - section.offset || section.size % element_sizes[i] != 0) {
+			throw std::logic_error("Broken base file: bad section "s + std::to_string(i));
+		}
+	}
+
+	const size_t stop_count = GetSection<Coordinates>(SectionId::StopCoordinates).size();
+	const size_t bus_count = GetSection<uint8_t>(SectionId::BusRouteTypes).size();
+	const size_t names_size = GetSection<char>(SectionId::Names).size();
+	const auto stop_name_offsets = GetSection<uint32_t>(SectionId::StopNameOffsets);
+	const auto bus_name_offsets = GetSection<uint32_t>(SectionId::BusNameOffsets);
+	const auto route_offsets = GetSection<uint32_t>(SectionId::RouteOffsets);
+	const auto route_stops = GetSection<uint32_t>(SectionId::RouteStops);
+	const auto is_stop_id = [stop_count](uint32_t id) {
+		return id < stop_count;
+	};
+	const auto distances = GetSection<Distance>(SectionId::Distances);
+	// a lookup takes a bucket modulo the pilot count and reads the fingerprint of a slot
+	const size_t name_index_size = GetSection<uint32_t>(SectionId::NameIndexValues).size();
+	const bool is_name_index_valid = GetSection<uint32_t>(SectionId::NameIndexFingerprints).size() == name_index_size
+									 && (name_index_size == 0 || !GetSection<uint32_t>(SectionId::NameIndexPilots).empty());
+	const bool is_valid = stop_name_offsets.size() == stop_count + 1
+						  && IsMonotonic(stop_name_offsets, names_size)
+						  && bus_name_offsets.size() == bus_count + 1
+						  && std::is_sorted(bus_name_offsets.begin(), bus_name_offsets.end())
+						  && bus_name_offsets[0] == stop_name_offsets[stop_count]
+						  && bus_name_offsets[bus_count] <= names_size
+						  && route_offsets.size() == bus_count + 1
+						  && IsMonotonic(route_offsets, route_stops.size())
+						  && std::all_of(route_stops.begin(), route_stops.end(), is_stop_id)
+						  && GetSection<BusInfo>(SectionId::BusInfos).size() == bus_count
+						  && std::all_of(distances.begin(), distances.end(), [&is_stop_id](const Distance& distance) {
+								 return is_stop_id(distance.from) && is_stop_id(distance.to);
+							 })
+						  && is_name_index_valid;
+	if (!is_valid) {
+		throw std::logic_error("Broken base file: inconsistent tables"s);
+	}
+}
+
+} // namespace flat_base
+} // namespace serialization
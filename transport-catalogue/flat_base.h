@@ -0,0 +1,121 @@
+#pragma once
+
+#include "ranges.h"
+#include "transport_catalogue.h"
+#include "transport_catalogue.pb.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace serialization {
+namespace flat_base {
+
+// flat binary base file: a header, the table of sections indexed by SectionId
+// and the sections themselves, each aligned to 8 bytes. Tables are plain arrays
+// of fixed-size records and offsets, so a mapped file is read without parsing.
+// This is not a zero-copy format and queries are not served from the mapping:
+// Reader copies the tables into a TransportCatalogue, which interns the names,
+// hashes the distances and builds its stop-to-buses index, and the routing graph
+// is not stored but built on start or taken from the artifact cache when cache_dir
+// is set. What the format saves is the protobuf parsing and the recomputation
+// of bus infos and the name index
+enum class SectionId : uint32_t {
+	StopCoordinates,        // Coordinates per stop
+	StopNameOffsets,        // stop count + 1 offsets into Names
+	BusNameOffsets,         // bus count + 1 offsets into Names
+	Names,                  // stop names followed by bus names
+	BusRouteTypes,          // uint8_t per bus, 1 for ring routes
+	RouteOffsets,           // bus count + 1 offsets into RouteStops
+	RouteStops,             // uint32_t stop ids of all routes
+	BusInfos,               // BusInfo per bus
+	Distances,              // Distance records
+	NameIndexPilots,        // uint32_t arrays of the perfect hash over names
+	NameIndexValues,
+	NameIndexFingerprints,
+	SpatialOrder,           // uint32_t permutation of the spatial index
+	Settings,               // db_proto::TC with render and route settings and responses
+	Count
+};
+
+struct Header {
+	char magic[8];
+	uint32_t version;
+	uint32_t section_count;
+	uint64_t name_index_seed;
+};
+
+struct Section {
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct Coordinates {
+	double lat;
+	double lng;
+};
+
+struct BusInfo {
+	uint32_t unique_stops;
+	uint32_t count_stops;
+	double geo_length;
+	double real_length;
+	double curvature;
+};
+
+struct Distance {
+	uint32_t from;
+	uint32_t to;
+	double length;
+};
+
+constexpr char kMagic[8] = {'T', 'C', 'F', 'L', 'A', 'T', '\0', '\0'};
+constexpr uint32_t kVersion = 1;
+
+bool IsFlatBase(const std::filesystem::path& path);
+
+void Write(const std::filesystem::path& path, const data_base::TransportCatalogue& tc,
+		   const db_proto::TC& settings);
+
+// read-only mapping of a whole file, the contents are copied into memory
+// where mmap is not available
+class MappedFile {
+public:
+	explicit MappedFile(const std::filesystem::path& path);
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	std::string_view GetData() const;
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	bool is_mapped_ = false;
+	std::vector<char> buffer_;
+};
+
+// validates the file on construction and throws std::logic_error if it is broken
+class Reader {
+public:
+	explicit Reader(const std::filesystem::path& path);
+
+	// fills an empty catalogue with bulk copies of the tables, by id and without
+	// name lookups, and freezes it; the mapping is not needed afterwards
+	void SetDB(data_base::TransportCatalogue& tc) const;
+	std::string_view GetSettings() const;
+
+private:
+	MappedFile file_;
+	const Header* header_ = nullptr;
+	const Section* sections_ = nullptr;
+
+	template <typename T>
+	ranges::Range<const T*> GetSection(SectionId id) const;
+	std::string_view GetName(ranges::Range<const uint32_t*> offsets, size_t index) const;
+	void Validate() const;
+};
+
+} // namespace flat_base
+} // namespace serialization
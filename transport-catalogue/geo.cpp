@@ -1,12 +1,169 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define GEO_KERNEL_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define GEO_KERNEL_SSE2
+#endif
+
 namespace geo {
+namespace {
+
+const int kEarthRadius = 6371000;
+// the same degree-to-radian factor as in ComputeDistance keeps both versions on one sphere
+const double kDegToRad = 3.1415926535 / 180.;
+const size_t kBatchSize = 64;
+
+// Taylor coefficients of arcsin: asin(x) = sum of kAsinCoeffs[n] * x^(2n + 1),
+// 25 terms give full double precision for |x| <= 0.5
+constexpr size_t kAsinTerms = 25;
+
+constexpr std::array<double, kAsinTerms> MakeAsinCoeffs() {
+	std::array<double, kAsinTerms> coeffs {};
+	double c = 1.;
+	for (size_t n = 0; n < kAsinTerms; ++n) {
+		coeffs[n] = c;
+		const double k = 2. * n + 1.;
+		c = c * k * k / ((k + 1.) * (k + 2.));
+	}
+	return coeffs;
+}
+
+constexpr std::array<double, kAsinTerms> kAsinCoeffs = MakeAsinCoeffs();
+
+// chord lengths of unit vectors into arc lengths on the Earth:
+// angle = 2 * asin(chord / 2), asin(x) for x > 0.5 is reduced to
+// pi / 2 - 2 * asin(sqrt((1 - x) / 2)) so the series argument stays below 0.5
+double ScalarChordToDistance(double chord_sq) {
+	double x = std::sqrt(chord_sq) * 0.5;
+	const bool is_reduced = x > 0.5;
+	if (is_reduced) {
+		x = std::sqrt((1. - x) * 0.5);
+	}
+	const double x2 = x * x;
+	double poly = kAsinCoeffs[kAsinTerms - 1];
+	for (size_t n = kAsinTerms - 1; n > 0; --n) {
+		poly = poly * x2 + kAsinCoeffs[n - 1];
+	}
+	double angle = poly * x;
+	if (is_reduced) {
+		angle = M_PI_2 - 2. * angle;
+	}
+	return 2. * angle * kEarthRadius;
+}
+
+} // namespace
+
+void ChordsToDistances(const double* chords_sq, size_t count, double* distances) {
+	size_t i = 0;
+#if defined(GEO_KERNEL_AVX2)
+	const __m256d half = _mm256_set1_pd(0.5);
+	const __m256d one = _mm256_set1_pd(1.);
+	const __m256d two = _mm256_set1_pd(2.);
+	const __m256d pi_2 = _mm256_set1_pd(M_PI_2);
+	const __m256d scale = _mm256_set1_pd(2. * kEarthRadius);
+	for (; i + 4 <= count; i += 4) {
+		__m256d x = _mm256_mul_pd(_mm256_sqrt_pd(_mm256_loadu_pd(chords_sq + i)), half);
+		const __m256d is_reduced = _mm256_cmp_pd(x, half, _CMP_GT_OQ);
+		const __m256d reduced = _mm256_sqrt_pd(_mm256_mul_pd(_mm256_sub_pd(one, x), half));
+		x = _mm256_blendv_pd(x, reduced, is_reduced);
+		const __m256d x2 = _mm256_mul_pd(x, x);
+		__m256d poly = _mm256_set1_pd(kAsinCoeffs[kAsinTerms - 1]);
+		for (size_t n = kAsinTerms - 1; n > 0; --n) {
+			poly = _mm256_fmadd_pd(poly, x2, _mm256_set1_pd(kAsinCoeffs[n - 1]));
+		}
+		__m256d angle = _mm256_mul_pd(poly, x);
+		angle = _mm256_blendv_pd(angle, _mm256_fnmadd_pd(two, angle, pi_2), is_reduced);
+		_mm256_storeu_pd(distances + i, _mm256_mul_pd(angle, scale));
+	}
+#elif defined(GEO_KERNEL_SSE2)
+	const __m128d half = _mm_set1_pd(0.5);
+	const __m128d one = _mm_set1_pd(1.);
+	const __m128d two = _mm_set1_pd(2.);
+	const __m128d pi_2 = _mm_set1_pd(M_PI_2);
+	const __m128d scale = _mm_set1_pd(2. * kEarthRadius);
+	for (; i + 2 <= count; i += 2) {
+		__m128d x = _mm_mul_pd(_mm_sqrt_pd(_mm_loadu_pd(chords_sq + i)), half);
+		const __m128d is_reduced = _mm_cmpgt_pd(x, half);
+		const __m128d reduced = _mm_sqrt_pd(_mm_mul_pd(_mm_sub_pd(one, x), half));
+		x = _mm_or_pd(_mm_and_pd(is_reduced, reduced), _mm_andnot_pd(is_reduced, x));
+		const __m128d x2 = _mm_mul_pd(x, x);
+		__m128d poly = _mm_set1_pd(kAsinCoeffs[kAsinTerms - 1]);
+		for (size_t n = kAsinTerms - 1; n > 0; --n) {
+			poly = _mm_add_pd(_mm_mul_pd(poly, x2), _mm_set1_pd(kAsinCoeffs[n - 1]));
+		}
+		__m128d angle = _mm_mul_pd(poly, x);
+		const __m128d reduced_angle = _mm_sub_pd(pi_2, _mm_mul_pd(two, angle));
+		angle = _mm_or_pd(_mm_and_pd(is_reduced, reduced_angle), _mm_andnot_pd(is_reduced, angle));
+		_mm_storeu_pd(distances + i, _mm_mul_pd(angle, scale));
+	}
+#endif
+	for (; i < count; ++i) {
+		distances[i] = ScalarChordToDistance(chords_sq[i]);
+	}
+}
+
+namespace {
+
+double GetChordSquare(const SpherePoints& points, uint32_t from, uint32_t to) {
+	const double dx = points.x[from] - points.x[to];
+	const double dy = points.y[from] - points.y[to];
+	const double dz = points.z[from] - points.z[to];
+	return dx * dx + dy * dy + dz * dz;
+}
+
+} // namespace
+
+void SpherePoints::Reserve(size_t count) {
+	x.reserve(count);
+	y.reserve(count);
+	z.reserve(count);
+}
+
+void SpherePoints::Add(Coordinates coordinates) {
+	const UnitVector vector = ToUnitVector(coordinates);
+	x.push_back(vector.x);
+	y.push_back(vector.y);
+	z.push_back(vector.z);
+}
+
+UnitVector SpherePoints::Get(size_t index) const {
+	return {x[index], y[index], z[index]};
+}
+
+UnitVector ToUnitVector(Coordinates coordinates) {
+	const double cos_lat = cos(coordinates.lat * kDegToRad);
+	return {
+		cos_lat * cos(coordinates.lng * kDegToRad),
+		cos_lat * sin(coordinates.lng * kDegToRad),
+		sin(coordinates.lat * kDegToRad)
+	};
+}
+
+double GetChordSquare(const UnitVector& from, const UnitVector& to) {
+	const double dx = from.x - to.x;
+	const double dy = from.y - to.y;
+	const double dz = from.z - to.z;
+	return dx * dx + dy * dy + dz * dz;
+}
+
+double DistanceToChordSquare(double distance) {
+	const double angle = distance / kEarthRadius;
+	if (angle >= M_PI) {
+		return 4.;
+	}
+	const double chord = 2. * sin(angle * 0.5);
+	return chord * chord;
+}
 
 double ComputeDistance(Coordinates from, Coordinates to)  {
-	const int kEarthRadius = 6371000;
 	if (from == to) {
 		return 0;
 	}
@@ -16,4 +173,54 @@ double ComputeDistance(Coordinates from, Coordinates to)  {
 				* kEarthRadius;
 }
 
+void ComputeDistances(const SpherePoints& points, const uint32_t* from, const uint32_t* to,
+					  size_t count, double* distances) {
+	// squared chords are gathered in place and turned into distances by the kernel
+	for (size_t i = 0; i < count; ++i) {
+		distances[i] = GetChordSquare(points, from[i], to[i]);
+	}
+	ChordsToDistances(distances, count, distances);
+}
+
+double ComputePathLength(const SpherePoints& points, const uint32_t* ids, size_t count) {
+	std::array<double, kBatchSize> chords_sq;
+	double length = 0;
+	for (size_t begin = 1; begin < count; begin += kBatchSize) {
+		const size_t batch = std::min(kBatchSize, count - begin);
+		for (size_t i = 0; i < batch; ++i) {
+			chords_sq[i] = GetChordSquare(points, ids[begin + i - 1], ids[begin + i]);
+		}
+		ChordsToDistances(chords_sq.data(), batch, chords_sq.data());
+		for (size_t i = 0; i < batch; ++i) {
+			length += chords_sq[i];
+		}
+	}
+	return length;
+}
+
+QuantizedCoordinates Quantize(Coordinates coordinates) {
+	static const double kMicroDegrees = 1e6;
+	return {
+		static_cast<int32_t>(std::lround(coordinates.lat * kMicroDegrees)),
+		static_cast<int32_t>(std::lround(coordinates.lng * kMicroDegrees))
+	};
+}
+
+Coordinates Dequantize(QuantizedCoordinates coordinates) {
+	static const double kMicroDegrees = 1e6;
+	return {coordinates.lat / kMicroDegrees, coordinates.lng / kMicroDegrees};
+}
+
+std::optional<QuantizedCoordinates> QuantizeExactly(Coordinates coordinates) {
+	// the range check also keeps lround within int32 and rejects NaN
+	if (!(std::abs(coordinates.lat) <= 180.) || !(std::abs(coordinates.lng) <= 180.)) {
+		return std::nullopt;
+	}
+	const QuantizedCoordinates quantized = Quantize(coordinates);
+	if (Dequantize(quantized) != coordinates) {
+		return std::nullopt;
+	}
+	return quantized;
+}
+
 }  // namespace geo
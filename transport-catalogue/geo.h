@@ -1,6 +1,9 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
 
 namespace geo {
 
@@ -15,6 +18,61 @@ struct Coordinates {
 	}
 };
 
+// coordinates in integer micro-degrees, the step is about 0.11 m
+struct QuantizedCoordinates {
+	int32_t lat;
+	int32_t lng;
+};
+
+struct UnitVector {
+	double x;
+	double y;
+	double z;
+};
+
+// points as unit vectors in parallel arrays; every vector is built once
+// from sin/cos of the point latitude and longitude, so distances between
+// stored points need no trigonometry except the final arcsine
+struct SpherePoints {
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> z;
+
+	void Reserve(size_t count);
+	void Add(Coordinates coordinates);
+	UnitVector Get(size_t index) const;
+};
+
+UnitVector ToUnitVector(Coordinates coordinates);
+double GetChordSquare(const UnitVector& from, const UnitVector& to);
+// squared chord between points that are distance meters apart along the sphere
+double DistanceToChordSquare(double distance);
+
 double ComputeDistance(Coordinates from, Coordinates to);
 
+// batch versions of ComputeDistance over SpherePoints, evaluated by a SIMD
+// (AVX2 or SSE2, scalar fallback) arcsine polynomial on chord lengths;
+// for distances up to 20015 km the result differs from ComputeDistance by less than
+// kBatchDistanceTolerance meters: away from the antipode the batch error is below 1e-3 m,
+// the rest is rounding of acos near 1 in ComputeDistance, which reaches
+// R * sqrt(2 * 2^-52) ~ 0.13 m for points a few meters apart (0.05 m measured);
+// within about 90 m of the antipode both formulas lose half of the digits
+// (the batch one in 1 - x of the reduced arcsine, acos near -1) and the measured
+// difference is up to 0.27 m, so the tolerance does not hold there
+inline constexpr double kBatchDistanceTolerance = 0.15;
+
+// distances[i] = distance between points from[i] and to[i]
+void ComputeDistances(const SpherePoints& points, const uint32_t* from, const uint32_t* to,
+					  size_t count, double* distances);
+// length of the polyline through points ids[0], ids[1], ..., ids[count - 1]
+double ComputePathLength(const SpherePoints& points, const uint32_t* ids, size_t count);
+// squared chord lengths into distances, chords_sq and distances may be the same array
+void ChordsToDistances(const double* chords_sq, size_t count, double* distances);
+
+QuantizedCoordinates Quantize(Coordinates coordinates);
+Coordinates Dequantize(QuantizedCoordinates coordinates);
+// nullopt unless the coordinates are a whole number of micro-degrees within [-180, 180],
+// e.g. parsed from at most six decimals, so that Dequantize gives them back exactly
+std::optional<QuantizedCoordinates> QuantizeExactly(Coordinates coordinates);
+
 } //namespace geo
@@ -2,22 +2,29 @@
 
 #include "ranges.h"
 
+#include <cstdint>
 #include <cstdlib>
 #include <vector>
-#include <string>
 
 namespace graph {
 
 using VertexId = size_t;
 using EdgeId = size_t;
 
+enum class EdgeType {
+	Bus,
+	Walk
+};
+
 template <typename Weight>
 struct Edge {
 	VertexId from;
 	VertexId to;
 	Weight weight;
 	size_t span_count;
-	std::string bus_name;
+	// symbol id of the bus name in the catalogue, resolved when a route is printed
+	uint32_t bus_name_id;
+	EdgeType type = EdgeType::Bus;
 };
 
 template <typename Weight>
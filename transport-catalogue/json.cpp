@@ -1,6 +1,5 @@
 #include "json.h"
-
-#include <iterator>
+#include "json_parser.h"
 
 namespace json {
 
@@ -109,220 +108,65 @@ const Node& Document::GetRoot() const {
 namespace {
 using namespace std::literals;
 
-Node LoadNode(std::istream& input);
-Node LoadString(std::istream& input);
+// Строит документ из узлов Node: словари — std::map, строки — копии
+class NodeBuilder {
+public:
+	using Value = Node;
+	using Key = std::string;
+	using ArrayState = Array;
+	using DictState = Dict;
 
-std::string LoadLiteral(std::istream& input) {
-	std::string s;
-	while (std::isalpha(input.peek())) {
-		s.push_back(static_cast<char>(input.get()));
+	Node Null() {
+		return Node{nullptr};
 	}
-	return s;
-}
 
-Node LoadArray(std::istream& input) {
-	std::vector<Node> result;
-
-	for (char c; input >> c && c != ']';) {
-		if (c != ',') {
-			input.putback(c);
-		}
-		result.push_back(LoadNode(input));
+	Node Bool(bool value) {
+		return Node{value};
 	}
-	if (!input) {
-		throw ParsingError("Array parsing error"s);
-	}
-	return Node(std::move(result));
-}
 
-Node LoadDict(std::istream& input) {
-	Dict dict;
-
-	for (char c; input >> c && c != '}';) {
-		if (c == '"') {
-			std::string key = LoadString(input).AsString();
-			if (input >> c && c == ':') {
-				if (dict.find(key) != dict.end()) {
-					throw ParsingError("Duplicate key '"s + key + "' have been found");
-				}
-				dict.emplace(std::move(key), LoadNode(input));
-			} else {
-				throw ParsingError(": is expected but '"s + c + "' has been found"s);
-			}
-		} else if (c != ',') {
-			throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
-		}
-	}
-	if (!input) {
-		throw ParsingError("Dictionary parsing error"s);
+	Node Int(int value) {
+		return Node{value};
 	}
-	return Node(std::move(dict));
-}
 
-Node LoadString(std::istream& input) {
-	auto it = std::istreambuf_iterator<char>(input);
-	auto end = std::istreambuf_iterator<char>();
-	std::string s;
-	while (true) {
-		if (it == end) {
-			throw ParsingError("String parsing error");
-		}
-		const char ch = *it;
-		if (ch == '"') {
-			++it;
-			break;
-		} else if (ch == '\\') {
-			++it;
-			if (it == end) {
-				throw ParsingError("String parsing error");
-			}
-			const char escaped_char = *(it);
-			switch (escaped_char) {
-				case 'n':
-					s.push_back('\n');
-					break;
-				case 't':
-					s.push_back('\t');
-					break;
-				case 'r':
-					s.push_back('\r');
-					break;
-				case '"':
-					s.push_back('"');
-					break;
-				case '\\':
-					s.push_back('\\');
-					break;
-				default:
-					throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
-			}
-		} else if (ch == '\n' || ch == '\r') {
-			throw ParsingError("Unexpected end of line"s);
-		} else {
-			s.push_back(ch);
-		}
-		++it;
+	Node Double(double value) {
+		return Node{value};
 	}
 
-	return Node(std::move(s));
-}
-
-Node LoadBool(std::istream& input) {
-	const auto s = LoadLiteral(input);
-	if (s == "true"sv) {
-		return Node{true};
-	} else if (s == "false"sv) {
-		return Node{false};
-	} else {
-		throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+	Node String(std::string_view value) {
+		return Node{std::string(value)};
 	}
-}
 
-Node LoadNull(std::istream& input) {
-	if (auto literal = LoadLiteral(input); literal == "null"sv) {
-		return Node{nullptr};
-	} else {
-		throw ParsingError("Failed to parse '"s + literal + "' as null"s);
+	Array StartArray() {
+		return {};
 	}
-}
-
-Node LoadNumber(std::istream& input) {
-	std::string parsed_num;
 
-	// Считывает в parsed_num очередной символ из input
-	auto read_char = [&parsed_num, &input] {
-		parsed_num += static_cast<char>(input.get());
-		if (!input) {
-			throw ParsingError("Failed to read number from stream"s);
-		}
-	};
-
-	// Считывает одну или более цифр в parsed_num из input
-	auto read_digits = [&input, read_char] {
-		if (!std::isdigit(input.peek())) {
-			throw ParsingError("A digit is expected"s);
-		}
-		while (std::isdigit(input.peek())) {
-			read_char();
-		}
-	};
-
-	if (input.peek() == '-') {
-		read_char();
+	void AddItem(Array& array, Node value) {
+		array.push_back(std::move(value));
 	}
-	// Парсим целую часть числа
-	if (input.peek() == '0') {
-		read_char();
-		// После 0 в JSON не могут идти другие цифры
-	} else {
-		read_digits();
+
+	Node EndArray(Array& array) {
+		return Node(std::move(array));
 	}
 
-	bool is_int = true;
-	// Парсим дробную часть числа
-	if (input.peek() == '.') {
-		read_char();
-		read_digits();
-		is_int = false;
+	Dict StartDict() {
+		return {};
 	}
 
-	// Парсим экспоненциальную часть числа
-	if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-		read_char();
-		if (ch = input.peek(); ch == '+' || ch == '-') {
-			read_char();
-		}
-		read_digits();
-		is_int = false;
+	std::string MakeKey(std::string_view key) {
+		return std::string(key);
 	}
 
-	try {
-		if (is_int) {
-			// Сначала пробуем преобразовать строку в int
-			try {
-				return std::stoi(parsed_num);
-			} catch (...) {
-				// В случае неудачи, например, при переполнении
-				// код ниже попробует преобразовать строку в double
-			}
+	void AddMember(Dict& dict, std::string key, Node value) {
+		// try_emplace не трогает key, если такой ключ уже есть
+		if (!dict.try_emplace(std::move(key), std::move(value)).second) {
+			throw ParsingError("Duplicate key '"s + key + "' have been found");
 		}
-		return std::stod(parsed_num);
-	} catch (...) {
-		throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
 	}
-}
 
-Node LoadNode(std::istream& input) {
-	char c;
-	if (!(input >> c)) {
-		throw ParsingError("Unexpected EOF"s);
-	}
-	switch (c) {
-		case '[':
-			return LoadArray(input);
-		case '{':
-			return LoadDict(input);
-		case '"':
-			return LoadString(input);
-		case 't':
-			// Атрибут [[fallthrough]] (провалиться) ничего не делает, и является
-			// подсказкой компилятору и человеку, что здесь программист явно задумывал
-			// разрешить переход к инструкции следующей ветки case, а не случайно забыл
-			// написать break, return или throw.
-			// В данном случае, встретив t или f, переходим к попытке парсинга
-			// литералов true либо false
-			[[fallthrough]];
-		case 'f':
-			input.putback(c);
-			return LoadBool(input);
-		case 'n':
-			input.putback(c);
-			return LoadNull(input);
-		default:
-			input.putback(c);
-			return LoadNumber(input);
+	Node EndDict(Dict& dict) {
+		return Node(std::move(dict));
 	}
-}
+};
 
 struct PrintContext {
 	std::ostream& out;
@@ -442,12 +286,24 @@ void PrintNode(const Node& node, const PrintContext& ctx) {
 
 }  // namespace
 
+Document Load(std::string_view text) {
+	NodeBuilder builder;
+	return Document{detail::Parser(text, builder).LoadNode()};
+}
+
 Document Load(std::istream& input) {
-	return Document{LoadNode(input)};
+	// Поток целиком считывается в память, дальше разбирается буфер
+	std::string text;
+	detail::ReadAll(input, text);
+	return Load(text);
 }
 
 void Print(const Document& doc, std::ostream& output) {
 	PrintNode(doc.GetRoot(), PrintContext{output});
 }
 
+void Print(const Node& node, std::ostream& output, int indent) {
+	PrintNode(node, PrintContext{output, 4, indent});
+}
+
 }  // namespace json
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -70,8 +71,14 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
 	return !(lhs == rhs);
 }
 
+// Разбирает документ из непрерывного буфера, например отображённого в память файла
+Document Load(std::string_view text);
+// Считывает поток до конца и разбирает его как буфер
 Document Load(std::istream& input);
 
 void Print(const Document& doc, std::ostream& output);
+// печатает узел так, как он выглядит внутри документа на глубине indent пробелов:
+// первая строка без отступа, закрывающая скобка с отступом indent
+void Print(const Node& node, std::ostream& output, int indent);
 
 }  // namespace json
@@ -0,0 +1,382 @@
+#include "json_arena.h"
+#include "json_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace json {
+namespace arena {
+
+/////////// ARENA ///////////
+void* Arena::Allocate(size_t size, size_t alignment) {
+	if (!blocks_.empty()) {
+		Block& block = blocks_.back();
+		const size_t offset = (block.used + alignment - 1) & ~(alignment - 1);
+		if (offset + size <= block.capacity) {
+			block.used = offset + size;
+			return block.data.get() + offset;
+		}
+	}
+	// память нового блока выровнена для любого типа
+	const size_t capacity = std::max(size, kMinBlockSize);
+	blocks_.push_back({std::make_unique<char[]>(capacity), capacity, size});
+	return blocks_.back().data.get();
+}
+
+std::string_view Arena::CopyString(std::string_view str) {
+	char* dest = AllocateArray<char>(str.size());
+	std::memcpy(dest, str.data(), str.size());
+	return {dest, str.size()};
+}
+
+Arena::Mark Arena::GetMark() const {
+	return blocks_.empty() ? Mark{} : Mark{blocks_.size(), blocks_.back().used};
+}
+
+void Arena::Rewind(Mark mark) {
+	blocks_.resize(mark.block_count);
+	if (!blocks_.empty()) {
+		blocks_.back().used = mark.used;
+	}
+}
+
+/////////// VALUE ///////////
+Value::Value(bool value)
+	: type_(Type::Bool) {
+	data_.boolean = value;
+}
+
+Value::Value(int value)
+	: type_(Type::Int) {
+	data_.integer = value;
+}
+
+Value::Value(double value)
+	: type_(Type::Double) {
+	data_.real = value;
+}
+
+Value::Value(std::string_view value)
+	: size_(static_cast<uint32_t>(value.size()))
+	, type_(Type::String) {
+	data_.chars = value.data();
+}
+
+Value Value::MakeArray(const Value* items, size_t size) {
+	Value value;
+	value.type_ = Type::Array;
+	value.data_.items = items;
+	value.size_ = static_cast<uint32_t>(size);
+	return value;
+}
+
+Value Value::MakeDict(const Member* members, size_t size) {
+	Value value;
+	value.type_ = Type::Dict;
+	value.data_.members = members;
+	value.size_ = static_cast<uint32_t>(size);
+	return value;
+}
+
+bool Value::IsNull() const {
+	return type_ == Type::Null;
+}
+
+bool Value::IsBool() const {
+	return type_ == Type::Bool;
+}
+
+bool Value::IsInt() const {
+	return type_ == Type::Int;
+}
+
+bool Value::IsPureDouble() const {
+	return type_ == Type::Double;
+}
+
+bool Value::IsDouble() const {
+	return IsInt() || IsPureDouble();
+}
+
+bool Value::IsString() const {
+	return type_ == Type::String;
+}
+
+bool Value::IsArray() const {
+	return type_ == Type::Array;
+}
+
+bool Value::IsDict() const {
+	return type_ == Type::Dict;
+}
+
+bool Value::AsBool() const {
+	using namespace std::literals;
+	if (!IsBool()) {
+		throw std::logic_error("Not a bool"s);
+	}
+	return data_.boolean;
+}
+
+int Value::AsInt() const {
+	using namespace std::literals;
+	if (!IsInt()) {
+		throw std::logic_error("Not an int"s);
+	}
+	return data_.integer;
+}
+
+double Value::AsDouble() const {
+	using namespace std::literals;
+	if (!IsDouble()) {
+		throw std::logic_error("Not a double"s);
+	}
+	return IsPureDouble() ? data_.real : data_.integer;
+}
+
+std::string_view Value::AsString() const {
+	using namespace std::literals;
+	if (!IsString()) {
+		throw std::logic_error("Not a string"s);
+	}
+	return {data_.chars, size_};
+}
+
+Array Value::AsArray() const {
+	using namespace std::literals;
+	if (!IsArray()) {
+		throw std::logic_error("Not an array"s);
+	}
+	return {data_.items, size_};
+}
+
+Dict Value::AsDict() const {
+	using namespace std::literals;
+	if (!IsDict()) {
+		throw std::logic_error("Not a dict"s);
+	}
+	return {data_.members, size_};
+}
+
+/////////// DICT ///////////
+Dict::const_iterator Dict::find(std::string_view key) const {
+	const auto it = std::lower_bound(begin(), end(), key, [](const Member& member, std::string_view key) {
+		return member.first < key;
+	});
+	return it != end() && it->first == key ? it : end();
+}
+
+size_t Dict::count(std::string_view key) const {
+	return find(key) != end() ? 1 : 0;
+}
+
+const Value& Dict::at(std::string_view key) const {
+	using namespace std::literals;
+	const auto it = find(key);
+	if (it == end()) {
+		throw std::out_of_range("Key '"s + std::string(key) + "' is not found"s);
+	}
+	return it->second;
+}
+
+/////////// DOCUMENT ///////////
+const Value& Document::GetRoot() const {
+	return root_;
+}
+
+namespace {
+using namespace std::literals;
+
+// Строит документ в арене: элементы незакрытых массивов и словарей копятся на
+// общих стеках и переносятся в арену одним куском при закрытии
+class ArenaBuilder {
+public:
+	using Value = arena::Value;
+	using Key = std::string_view;
+	using ArrayState = size_t;
+	using DictState = size_t;
+
+	ArenaBuilder(std::string_view text, Arena& arena)
+		: text_(text)
+		, arena_(arena) {
+	}
+
+	Value Null() {
+		return Value{};
+	}
+
+	Value Bool(bool value) {
+		return Value{value};
+	}
+
+	Value Int(int value) {
+		return Value{value};
+	}
+
+	Value Double(double value) {
+		return Value{value};
+	}
+
+	Value String(std::string_view value) {
+		return Value{Keep(value)};
+	}
+
+	size_t StartArray() {
+		return items_.size();
+	}
+
+	void AddItem(size_t, Value value) {
+		items_.push_back(value);
+	}
+
+	Value EndArray(size_t start) {
+		const size_t size = items_.size() - start;
+		Value* items = arena_.AllocateArray<Value>(size);
+		std::uninitialized_copy(items_.begin() + start, items_.end(), items);
+		items_.resize(start);
+		return Value::MakeArray(items, size);
+	}
+
+	size_t StartDict() {
+		return members_.size();
+	}
+
+	std::string_view MakeKey(std::string_view key) {
+		return Keep(key);
+	}
+
+	void AddMember(size_t, std::string_view key, Value value) {
+		members_.emplace_back(key, value);
+	}
+
+	Value EndDict(size_t start) {
+		const auto first = members_.begin() + start;
+		std::sort(first, members_.end(), [](const Member& lhs, const Member& rhs) {
+			return lhs.first < rhs.first;
+		});
+		if (const auto duplicate = std::adjacent_find(first, members_.end(), [](const Member& lhs, const Member& rhs) {
+				return lhs.first == rhs.first;
+			});
+			duplicate != members_.end()) {
+			throw ParsingError("Duplicate key '"s + std::string(duplicate->first) + "' have been found");
+		}
+
+		const size_t size = members_.size() - start;
+		Member* members = arena_.AllocateArray<Member>(size);
+		std::uninitialized_copy(first, members_.end(), members);
+		members_.resize(start);
+		return Value::MakeDict(members, size);
+	}
+
+protected:
+	std::string_view text_;
+	Arena& arena_;
+	std::vector<Value> items_;
+	std::vector<Member> members_;
+
+	// строка из буфера документа остаётся ссылкой на него, раскодированная копируется в арену
+	std::string_view Keep(std::string_view str) {
+		if (str.data() >= text_.data() && str.data() + str.size() <= text_.data() + text_.size()) {
+			return str;
+		}
+		return arena_.CopyString(str);
+	}
+};
+
+// Строит документ так же, но элементы массива root[key] отдаёт handler по одному
+// и откатывает арену к состоянию до элемента
+class StreamingBuilder : public ArenaBuilder {
+public:
+	StreamingBuilder(std::string_view text, Arena& arena, std::string_view key,
+					 const std::function<void(const Value&)>& handler)
+		: ArenaBuilder(text, arena)
+		, key_(key)
+		, handler_(handler) {
+	}
+
+	size_t StartArray() {
+		// массив-значение ключа key корневого словаря
+		if (depth_ == 1 && last_root_key_ == key_) {
+			stream_depth_ = depth_ + 1;
+			stream_mark_ = arena_.GetMark();
+		}
+		++depth_;
+		return ArenaBuilder::StartArray();
+	}
+
+	void AddItem(size_t start, Value value) {
+		if (depth_ != stream_depth_) {
+			ArenaBuilder::AddItem(start, value);
+			return;
+		}
+		handler_(value);
+		arena_.Rewind(stream_mark_);
+	}
+
+	Value EndArray(size_t start) {
+		if (depth_-- == stream_depth_) {
+			stream_depth_ = 0;
+		}
+		return ArenaBuilder::EndArray(start);
+	}
+
+	size_t StartDict() {
+		++depth_;
+		return ArenaBuilder::StartDict();
+	}
+
+	std::string_view MakeKey(std::string_view key) {
+		const std::string_view kept = ArenaBuilder::MakeKey(key);
+		// ключ корневого словаря
+		if (depth_ == 1) {
+			last_root_key_ = kept;
+		}
+		return kept;
+	}
+
+	Value EndDict(size_t start) {
+		--depth_;
+		return ArenaBuilder::EndDict(start);
+	}
+
+private:
+	std::string_view key_;
+	const std::function<void(const Value&)>& handler_;
+	size_t depth_ = 0;
+	std::string_view last_root_key_;
+	// глубина потокового массива, 0 вне его
+	size_t stream_depth_ = 0;
+	Arena::Mark stream_mark_;
+};
+
+} // namespace
+
+Document Load(std::string_view text) {
+	Document document;
+	ArenaBuilder builder(text, document.arena_);
+	document.root_ = detail::Parser(text, builder).LoadNode();
+	return document;
+}
+
+Document Load(std::istream& input) {
+	Document document;
+	detail::ReadAll(input, document.text_);
+	const std::string_view text(document.text_.data(), document.text_.size());
+	ArenaBuilder builder(text, document.arena_);
+	document.root_ = detail::Parser(text, builder).LoadNode();
+	return document;
+}
+
+Document LoadStreaming(std::istream& input, std::string_view key, const std::function<void(const Value&)>& handler) {
+	Document document;
+	detail::ReadAll(input, document.text_);
+	const std::string_view text(document.text_.data(), document.text_.size());
+	StreamingBuilder builder(text, document.arena_, key, handler);
+	document.root_ = detail::Parser(text, builder).LoadNode();
+	return document;
+}
+
+} // namespace arena
+} // namespace json
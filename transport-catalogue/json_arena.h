@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace json {
+namespace arena {
+
+// Представление документа только для чтения, которое целиком лежит в монотонной
+// арене: массивы и словари — непрерывные массивы узлов, словари отсортированы по
+// ключу, строки без экранирования указывают прямо в разобранный текст.
+// Узлы действительны, пока жив Document
+
+// Монотонный аллокатор: память выделяется блоками и освобождается только вместе
+// с ареной, блоки не перемещаются
+class Arena {
+public:
+	Arena() = default;
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	Arena(Arena&&) = default;
+	Arena& operator=(Arena&&) = default;
+
+	void* Allocate(size_t size, size_t alignment);
+
+	template <typename T>
+	T* AllocateArray(size_t count) {
+		return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	std::string_view CopyString(std::string_view str);
+
+	// Положение арены; Rewind освобождает всё, что выделено после Mark
+	struct Mark {
+		size_t block_count = 0;
+		size_t used = 0;
+	};
+	Mark GetMark() const;
+	void Rewind(Mark mark);
+
+private:
+	struct Block {
+		std::unique_ptr<char[]> data;
+		size_t capacity = 0;
+		size_t used = 0;
+	};
+	static constexpr size_t kMinBlockSize = 64 * 1024;
+
+	std::vector<Block> blocks_;
+};
+
+class Value;
+class Array;
+class Dict;
+using Member = std::pair<std::string_view, Value>;
+
+// 16 байт на узел: тип, длина строки или контейнера и указатель либо значение
+class Value {
+public:
+	Value() = default;
+	explicit Value(std::nullptr_t) {
+	}
+	explicit Value(bool value);
+	explicit Value(int value);
+	explicit Value(double value);
+	// строка должна жить не меньше документа
+	explicit Value(std::string_view value);
+	Value(const char*) = delete;
+
+	static Value MakeArray(const Value* items, size_t size);
+	static Value MakeDict(const Member* members, size_t size);
+
+	bool IsNull() const;
+	bool IsBool() const;
+	bool IsInt() const;
+	bool IsPureDouble() const;
+	bool IsDouble() const;
+	bool IsString() const;
+	bool IsArray() const;
+	bool IsDict() const;
+
+	bool AsBool() const;
+	int AsInt() const;
+	double AsDouble() const;
+	std::string_view AsString() const;
+	Array AsArray() const;
+	Dict AsDict() const;
+
+private:
+	enum class Type : uint8_t {
+		Null,
+		Bool,
+		Int,
+		Double,
+		String,
+		Array,
+		Dict
+	};
+
+	union Data {
+		bool boolean;
+		int integer;
+		double real;
+		const char* chars;
+		const Value* items;
+		const Member* members;
+	};
+
+	Data data_{};
+	uint32_t size_ = 0;
+	Type type_ = Type::Null;
+};
+
+class Array {
+public:
+	using const_iterator = const Value*;
+
+	Array() = default;
+	Array(const Value* items, size_t size)
+		: items_(items)
+		, size_(size) {
+	}
+
+	const_iterator begin() const {
+		return items_;
+	}
+	const_iterator end() const {
+		return items_ + size_;
+	}
+	size_t size() const {
+		return size_;
+	}
+	bool empty() const {
+		return size_ == 0;
+	}
+	const Value& operator[](size_t index) const {
+		return items_[index];
+	}
+
+private:
+	const Value* items_ = nullptr;
+	size_t size_ = 0;
+};
+
+// Члены отсортированы по ключу в том же порядке, что и в std::map<std::string, ...>,
+// поиск двоичный. Интерфейс повторяет нужную часть std::map
+class Dict {
+public:
+	using const_iterator = const Member*;
+
+	Dict() = default;
+	Dict(const Member* members, size_t size)
+		: members_(members)
+		, size_(size) {
+	}
+
+	const_iterator begin() const {
+		return members_;
+	}
+	const_iterator end() const {
+		return members_ + size_;
+	}
+	size_t size() const {
+		return size_;
+	}
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	const_iterator find(std::string_view key) const;
+	size_t count(std::string_view key) const;
+	// бросает std::out_of_range, если ключа нет
+	const Value& at(std::string_view key) const;
+
+private:
+	const Member* members_ = nullptr;
+	size_t size_ = 0;
+};
+
+class Document {
+public:
+	Document() = default;
+
+	const Value& GetRoot() const;
+
+private:
+	friend Document Load(std::string_view text);
+	friend Document Load(std::istream& input);
+	friend Document LoadStreaming(std::istream& input, std::string_view key, const std::function<void(const Value&)>& handler);
+
+	// собственная копия текста, если документ прочитан из потока
+	std::vector<char> text_;
+	Arena arena_;
+	Value root_;
+};
+
+// Строки документа могут указывать в text, поэтому text должен жить не меньше документа
+Document Load(std::string_view text);
+// Считывает поток до конца, документ хранит текст сам
+Document Load(std::istream& input);
+// Как Load, но элементы массива root[key] не сохраняются: каждый передаётся handler,
+// как только разобран, и его память сразу переиспользуется. Узел действителен только
+// во время вызова, в документе вместо массива остаётся пустой
+Document LoadStreaming(std::istream& input, std::string_view key, const std::function<void(const Value&)>& handler);
+
+} // namespace arena
+} // namespace json
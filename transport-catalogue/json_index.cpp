@@ -0,0 +1,276 @@
+#include "json_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JSON_INDEX_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define JSON_INDEX_SSE2
+#endif
+
+namespace json {
+namespace structural {
+namespace {
+
+constexpr size_t kBlockSize = 64;
+
+// Битовые маски блока: i-й бит соответствует i-му байту
+struct BlockMasks {
+	uint64_t quote = 0;
+	uint64_t backslash = 0;
+	uint64_t op = 0;          // { } [ ] : ,
+	uint64_t space = 0;
+	uint64_t line_break = 0;  // \n и \r
+};
+
+#if defined(JSON_INDEX_AVX2)
+using Vector = __m256i;
+
+Vector Load(const char* data) {
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+Vector Splat(char c) {
+	return _mm256_set1_epi8(c);
+}
+
+Vector Equal(Vector lhs, Vector rhs) {
+	return _mm256_cmpeq_epi8(lhs, rhs);
+}
+
+Vector Or(Vector lhs, Vector rhs) {
+	return _mm256_or_si256(lhs, rhs);
+}
+
+Vector Sub(Vector lhs, Vector rhs) {
+	return _mm256_sub_epi8(lhs, rhs);
+}
+
+Vector MinUnsigned(Vector lhs, Vector rhs) {
+	return _mm256_min_epu8(lhs, rhs);
+}
+
+uint64_t MoveMask(Vector bytes) {
+	return static_cast<uint32_t>(_mm256_movemask_epi8(bytes));
+}
+#elif defined(JSON_INDEX_SSE2)
+using Vector = __m128i;
+
+Vector Load(const char* data) {
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+Vector Splat(char c) {
+	return _mm_set1_epi8(c);
+}
+
+Vector Equal(Vector lhs, Vector rhs) {
+	return _mm_cmpeq_epi8(lhs, rhs);
+}
+
+Vector Or(Vector lhs, Vector rhs) {
+	return _mm_or_si128(lhs, rhs);
+}
+
+Vector Sub(Vector lhs, Vector rhs) {
+	return _mm_sub_epi8(lhs, rhs);
+}
+
+Vector MinUnsigned(Vector lhs, Vector rhs) {
+	return _mm_min_epu8(lhs, rhs);
+}
+
+uint64_t MoveMask(Vector bytes) {
+	return static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+}
+#endif
+
+#if defined(JSON_INDEX_AVX2) || defined(JSON_INDEX_SSE2)
+// Блок читается частями по ширине регистра; сравнения одного класса объединяются
+// до movemask, так что на класс и часть приходится одна маска
+BlockMasks ClassifyBlock(const char* data) {
+	constexpr size_t kPartSize = sizeof(Vector);
+	const Vector lower_bit = Splat(0x20);
+	const Vector space_first = Splat('\t');
+	const Vector space_width = Splat('\r' - '\t');
+
+	BlockMasks masks;
+	for (size_t part = 0; part < kBlockSize / kPartSize; ++part) {
+		const Vector bytes = Load(data + part * kPartSize);
+		// после установки бита 0x20 скобки [ и ] совпадают с { и }
+		const Vector lower = Or(bytes, lower_bit);
+		const Vector op = Or(Or(Equal(lower, Splat('{')), Equal(lower, Splat('}'))),
+							 Or(Equal(bytes, Splat(':')), Equal(bytes, Splat(','))));
+		// \t, \n, \v, \f и \r идут подряд: байт из этого отрезка после вычитания \t
+		// не больше ширины отрезка
+		const Vector shifted = Sub(bytes, space_first);
+		const Vector space = Or(Equal(bytes, Splat(' ')), Equal(MinUnsigned(shifted, space_width), shifted));
+		const Vector line_break = Or(Equal(bytes, Splat('\n')), Equal(bytes, Splat('\r')));
+
+		const size_t shift = part * kPartSize;
+		masks.quote |= MoveMask(Equal(bytes, Splat('"'))) << shift;
+		masks.backslash |= MoveMask(Equal(bytes, Splat('\\'))) << shift;
+		masks.op |= MoveMask(op) << shift;
+		masks.space |= MoveMask(space) << shift;
+		masks.line_break |= MoveMask(line_break) << shift;
+	}
+	return masks;
+}
+#else
+BlockMasks ClassifyBlock(const char* data) {
+	BlockMasks masks;
+	for (size_t i = 0; i < kBlockSize; ++i) {
+		const uint64_t bit = uint64_t{1} << i;
+		switch (data[i]) {
+			case '"':
+				masks.quote |= bit;
+				break;
+			case '\\':
+				masks.backslash |= bit;
+				break;
+			case '{': case '}': case '[': case ']': case ':': case ',':
+				masks.op |= bit;
+				break;
+			case '\n': case '\r':
+				masks.line_break |= bit;
+				masks.space |= bit;
+				break;
+			case ' ': case '\t': case '\v': case '\f':
+				masks.space |= bit;
+				break;
+			default:
+				break;
+		}
+	}
+	return masks;
+}
+#endif
+
+int CountTrailingZeros(uint64_t value) {
+#if defined(__GNUC__)
+	return __builtin_ctzll(value);
+#else
+	int count = 0;
+	while ((value & 1) == 0) {
+		value >>= 1;
+		++count;
+	}
+	return count;
+#endif
+}
+
+// i-й бит результата — xor битов с 0-го по i-й: единицы от открывающей кавычки
+// включительно до закрывающей не включительно
+uint64_t PrefixXor(uint64_t value) {
+	value ^= value << 1;
+	value ^= value << 2;
+	value ^= value << 4;
+	value ^= value << 8;
+	value ^= value << 16;
+	value ^= value << 32;
+	return value;
+}
+
+// Отмечает символы, перед которыми стоит экранирующий слеш. Слеши в JSON редки,
+// поэтому они перебираются по одному; carry переносит экранирование в следующий блок
+uint64_t FindEscaped(uint64_t backslash, uint64_t& carry) {
+	uint64_t escaped = carry;
+	carry = 0;
+	backslash &= ~escaped;
+	while (backslash != 0) {
+		const int bit = CountTrailingZeros(backslash);
+		if (bit == 63) {
+			carry = 1;
+		} else {
+			escaped |= uint64_t{2} << bit;
+		}
+		backslash &= ~(escaped | uint64_t{1} << bit);
+	}
+	return escaped;
+}
+
+// Возвращает маску значимых позиций блока
+uint64_t ScanBlock(const char* data, ScanState& state) {
+	const BlockMasks masks = ClassifyBlock(data);
+	const uint64_t escaped = masks.backslash != 0 || state.escape_carry != 0
+		? FindEscaped(masks.backslash, state.escape_carry)
+		: 0;
+	const uint64_t quote = masks.quote & ~escaped;
+	const uint64_t in_string = PrefixXor(quote) ^ state.in_string_carry;
+	state.in_string_carry = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+	const uint64_t scalar = ~(masks.op | masks.space | masks.quote) & ~in_string;
+	const uint64_t scalar_starts = scalar & ~(scalar << 1 | state.scalar_carry);
+	state.scalar_carry = scalar >> 63;
+
+	const uint64_t string_specials = ((masks.backslash | masks.line_break) & ~escaped) & in_string;
+	return (masks.op & ~in_string) | quote | scalar_starts | string_specials;
+}
+
+int PopCount(uint64_t value) {
+#if defined(__GNUC__)
+	return __builtin_popcountll(value);
+#else
+	int count = 0;
+	for (; value != 0; value &= value - 1) {
+		++count;
+	}
+	return count;
+#endif
+}
+
+// Пишет позиции единичных битов группами по восемь без ветвлений на каждый бит.
+// Лишние записи после последнего бита не выходят за место, отведённое под блок
+uint32_t* AppendPositions(uint64_t bits, uint32_t offset, uint32_t* out) {
+	// старший бит не меняет младший единичный бит и не даёт считать нули в пустой маске
+	constexpr uint64_t kGuard = uint64_t{1} << 63;
+	const int count = PopCount(bits);
+	for (int i = 0; i < count; i += 8) {
+		for (int j = 0; j < 8; ++j) {
+			out[i + j] = offset + static_cast<uint32_t>(CountTrailingZeros(bits | kGuard));
+			bits &= bits - 1;
+		}
+	}
+	return out + count;
+}
+
+} // namespace
+
+static_assert(Index::kWindowSize % kBlockSize == 0);
+
+Index::Index(std::string_view text)
+	: text_(text)
+	, window_(text.data())
+	, positions_(new uint32_t[kWindowSize]) {
+}
+
+bool Index::Refill() {
+	size_ = 0;
+	next_ = 0;
+	while (size_ == 0 && window_end_ < text_.size()) {
+		const size_t window_begin = window_end_;
+		window_end_ = std::min(text_.size(), window_begin + kWindowSize);
+		window_ = text_.data() + window_begin;
+
+		uint32_t* out = positions_.get();
+		size_t offset = 0;
+		for (; window_begin + offset + kBlockSize <= window_end_; offset += kBlockSize) {
+			out = AppendPositions(ScanBlock(window_ + offset, state_), static_cast<uint32_t>(offset), out);
+		}
+		if (window_begin + offset < window_end_) {
+			// Хвост документа дополняется пробелами до целого блока
+			char tail[kBlockSize];
+			std::memset(tail, ' ', kBlockSize);
+			std::memcpy(tail, window_ + offset, window_end_ - window_begin - offset);
+			out = AppendPositions(ScanBlock(tail, state_), static_cast<uint32_t>(offset), out);
+		}
+		size_ = out - positions_.get();
+	}
+	return size_ != 0;
+}
+
+} // namespace structural
+} // namespace json
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace json {
+namespace structural {
+
+// Состояние первой стадии, которое переходит от одного 64-байтного блока к другому
+struct ScanState {
+	uint64_t escape_carry = 0;
+	uint64_t in_string_carry = 0;  // все единицы, если блок начинается внутри строки
+	uint64_t scalar_carry = 0;     // предыдущий блок закончился внутри числа или литерала
+};
+
+// Первая стадия разбора: блоками по 64 байта строит битовые маски и по ним список
+// позиций, на которые парсеру нужно смотреть. В него попадают:
+// - структурные символы { } [ ] : , вне строк;
+// - открывающие и закрывающие кавычки строк;
+// - начала чисел и литералов вне строк;
+// - внутри строк — экранирующие обратные слеши и переводы строк.
+// Пробелы и содержимое строк в список не попадают, поэтому вторая стадия
+// переходит от одной значимой позиции к другой без побайтового просмотра.
+// Индекс строится окнами по kWindowSize байт по мере чтения, так что обе стадии
+// работают с участком буфера, который ещё лежит в кэше
+class Index {
+public:
+	static constexpr size_t kWindowSize = 16 * 1024;
+
+	explicit Index(std::string_view text);
+
+	// Возвращает следующую значимую позицию или nullptr в конце документа
+	const char* Next() {
+		if (next_ == size_ && !Refill()) {
+			return nullptr;
+		}
+		return window_ + positions_[next_++];
+	}
+
+	// Следующая позиция без продвижения по индексу
+	const char* Peek() {
+		if (next_ == size_ && !Refill()) {
+			return nullptr;
+		}
+		return window_ + positions_[next_];
+	}
+
+	// Возвращает позицию, только что полученную из Next
+	void PutBack() {
+		--next_;
+	}
+
+private:
+	std::string_view text_;
+	const char* window_;
+	size_t window_end_ = 0;
+	ScanState state_;
+	// смещения от начала окна: в окне не больше kWindowSize позиций
+	std::unique_ptr<uint32_t[]> positions_;
+	size_t size_ = 0;
+	size_t next_ = 0;
+
+	// Строит индекс следующего окна, в котором есть значимые позиции
+	bool Refill();
+};
+
+} // namespace structural
+} // namespace json
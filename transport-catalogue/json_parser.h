@@ -0,0 +1,319 @@
+#pragma once
+
+#include "json.h"
+#include "json_index.h"
+
+#include <charconv>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace json {
+namespace detail {
+
+// Считывает поток до конца блоками и дописывает его в конец text
+template <typename Buffer>
+void ReadAll(std::istream& input, Buffer& text) {
+	char buffer[1 << 16];
+	while (input.read(buffer, sizeof(buffer)) || input.gcount() > 0) {
+		text.insert(text.end(), buffer, buffer + input.gcount());
+	}
+}
+
+// Вторая стадия разбора документа, целиком лежащего в непрерывном буфере: парсер
+// переходит по позициям структурного индекса, а числа и литералы читает по указателю.
+// Узлы создаёт Builder, так что один парсер строит разные представления документа:
+//   Value Null(), Bool(bool), Int(int), Double(double), String(std::string_view);
+//   ArrayState StartArray(), void AddItem(ArrayState&, Value), Value EndArray(ArrayState&);
+//   DictState StartDict(), Key MakeKey(std::string_view),
+//   void AddMember(DictState&, Key, Value), Value EndDict(DictState&).
+// Строка, переданная в String или MakeKey, — либо участок буфера, если в ней нет
+// экранирования, либо раскодированная копия, которая живёт до следующей строки
+template <typename Builder>
+class Parser {
+public:
+	using Value = typename Builder::Value;
+
+	Parser(std::string_view text, Builder& builder)
+		: pos_(text.data())
+		, end_(text.data() + text.size())
+		, index_(text)
+		, builder_(builder) {
+	}
+
+	Value LoadNode() {
+		using namespace std::literals;
+		char c;
+		if (!ReadChar(c)) {
+			throw ParsingError("Unexpected EOF"s);
+		}
+		switch (c) {
+			case '[':
+				return LoadArray();
+			case '{':
+				return LoadDict();
+			case '"':
+				return builder_.String(LoadStringValue());
+			case 't':
+				// Встретив t или f, переходим к попытке парсинга литералов true либо false
+				[[fallthrough]];
+			case 'f':
+				--pos_;
+				return LoadBool();
+			case 'n':
+				--pos_;
+				return LoadNull();
+			default:
+				--pos_;
+				return LoadNumber();
+		}
+	}
+
+private:
+	const char* pos_;
+	const char* end_;
+	structural::Index index_;
+	Builder& builder_;
+	// раскодированная строка с экранированием
+	std::string scratch_;
+
+	static bool IsSpace(char c) {
+		return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	static bool IsDigit(char c) {
+		return c >= '0' && c <= '9';
+	}
+
+	static bool IsAlpha(char c) {
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	}
+
+	// Читает символ в следующей позиции индекса, как input >> c: пробелы между
+	// позициями индекса пропускаются без просмотра
+	bool ReadChar(char& c) {
+		const char* next = index_.Next();
+		if (next == nullptr) {
+			pos_ = end_;
+			return false;
+		}
+		pos_ = next;
+		c = *pos_++;
+		return true;
+	}
+
+	// Возвращает прочитанный ReadChar символ, как input.putback
+	void PutBack() {
+		--pos_;
+		index_.PutBack();
+	}
+
+	// Число или литерал должны заканчиваться пробелом или следующей позицией индекса,
+	// иначе хвост вроде 12abc был бы пропущен
+	void CheckValueEnd() {
+		using namespace std::literals;
+		if (pos_ != end_ && !IsSpace(*pos_) && pos_ != index_.Peek()) {
+			throw ParsingError("Unexpected character '"s + *pos_ + "' after value"s);
+		}
+	}
+
+	char Peek() const {
+		return pos_ == end_ ? '\0' : *pos_;
+	}
+
+	std::string_view LoadLiteral() {
+		const char* begin = pos_;
+		while (pos_ != end_ && IsAlpha(*pos_)) {
+			++pos_;
+		}
+		CheckValueEnd();
+		return {begin, static_cast<size_t>(pos_ - begin)};
+	}
+
+	Value LoadArray() {
+		using namespace std::literals;
+		auto array = builder_.StartArray();
+
+		char c;
+		bool is_closed = false;
+		while (ReadChar(c)) {
+			if (c == ']') {
+				is_closed = true;
+				break;
+			}
+			if (c != ',') {
+				PutBack();
+			}
+			builder_.AddItem(array, LoadNode());
+		}
+		if (!is_closed) {
+			throw ParsingError("Array parsing error"s);
+		}
+		return builder_.EndArray(array);
+	}
+
+	Value LoadDict() {
+		using namespace std::literals;
+		auto dict = builder_.StartDict();
+
+		char c;
+		bool is_closed = false;
+		while (ReadChar(c)) {
+			if (c == '}') {
+				is_closed = true;
+				break;
+			}
+			if (c == '"') {
+				auto key = builder_.MakeKey(LoadStringValue());
+				if (ReadChar(c) && c == ':') {
+					builder_.AddMember(dict, std::move(key), LoadNode());
+				} else {
+					throw ParsingError(": is expected but '"s + c + "' has been found"s);
+				}
+			} else if (c != ',') {
+				throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+			}
+		}
+		if (!is_closed) {
+			throw ParsingError("Dictionary parsing error"s);
+		}
+		return builder_.EndDict(dict);
+	}
+
+	std::string_view LoadStringValue() {
+		using namespace std::literals;
+		// Внутри строки индекс содержит только закрывающую кавычку, экранирующие
+		// слеши и переводы строк. Строка без них отдаётся как участок буфера
+		const char* begin = pos_;
+		const char* special = index_.Next();
+		if (special != nullptr && *special == '"') {
+			pos_ = special + 1;
+			return {begin, static_cast<size_t>(special - begin)};
+		}
+
+		// Иначе участки между особыми позициями копируются целиком
+		scratch_.clear();
+		for (;; special = index_.Next()) {
+			if (special == nullptr) {
+				throw ParsingError("String parsing error");
+			}
+			scratch_.append(pos_, special);
+			pos_ = special + 1;
+			const char ch = *special;
+			if (ch == '"') {
+				break;
+			} else if (ch == '\\') {
+				if (pos_ == end_) {
+					throw ParsingError("String parsing error");
+				}
+				const char escaped_char = *pos_++;
+				switch (escaped_char) {
+					case 'n':
+						scratch_.push_back('\n');
+						break;
+					case 't':
+						scratch_.push_back('\t');
+						break;
+					case 'r':
+						scratch_.push_back('\r');
+						break;
+					case '"':
+						scratch_.push_back('"');
+						break;
+					case '\\':
+						scratch_.push_back('\\');
+						break;
+					default:
+						throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+				}
+			} else {
+				throw ParsingError("Unexpected end of line"s);
+			}
+		}
+		return scratch_;
+	}
+
+	Value LoadBool() {
+		using namespace std::literals;
+		const auto s = LoadLiteral();
+		if (s == "true"sv) {
+			return builder_.Bool(true);
+		} else if (s == "false"sv) {
+			return builder_.Bool(false);
+		} else {
+			throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
+		}
+	}
+
+	Value LoadNull() {
+		using namespace std::literals;
+		if (auto literal = LoadLiteral(); literal == "null"sv) {
+			return builder_.Null();
+		} else {
+			throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
+		}
+	}
+
+	Value LoadNumber() {
+		using namespace std::literals;
+		const char* begin = pos_;
+
+		// Считывает одну или более цифр
+		auto read_digits = [this] {
+			if (!IsDigit(Peek())) {
+				throw ParsingError("A digit is expected"s);
+			}
+			while (IsDigit(Peek())) {
+				++pos_;
+			}
+		};
+
+		if (Peek() == '-') {
+			++pos_;
+		}
+		// Парсим целую часть числа
+		if (Peek() == '0') {
+			++pos_;
+			// После 0 в JSON не могут идти другие цифры
+		} else {
+			read_digits();
+		}
+
+		bool is_int = true;
+		// Парсим дробную часть числа
+		if (Peek() == '.') {
+			++pos_;
+			read_digits();
+			is_int = false;
+		}
+
+		// Парсим экспоненциальную часть числа
+		if (char ch = Peek(); ch == 'e' || ch == 'E') {
+			++pos_;
+			if (ch = Peek(); ch == '+' || ch == '-') {
+				++pos_;
+			}
+			read_digits();
+			is_int = false;
+		}
+		CheckValueEnd();
+
+		if (is_int) {
+			// Сначала пробуем преобразовать строку в int, при переполнении
+			// код ниже преобразует её в double
+			int value;
+			if (const auto [ptr, ec] = std::from_chars(begin, pos_, value); ec == std::errc{} && ptr == pos_) {
+				return builder_.Int(value);
+			}
+		}
+		double value;
+		if (const auto [ptr, ec] = std::from_chars(begin, pos_, value); ec == std::errc{} && ptr == pos_) {
+			return builder_.Double(value);
+		}
+		throw ParsingError("Failed to convert "s + std::string(begin, pos_) + " to number"s);
+	}
+};
+
+} // namespace detail
+} // namespace json
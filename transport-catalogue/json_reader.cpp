@@ -1,25 +1,212 @@
 #include "json_reader.h"
+#include "content_hash.h"
 #include "json_builder.h"
 #include "map_renderer.h"
 #include "svg.h"
 
+#include <array>
 #include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace json_reader {
 
-JsonReader::JsonReader(data_base::TransportCatalogue &db,
-                       router::TransportRouter& tr, serialization::Serialization &sr)
-    : db_(std::make_unique<data_base::TransportCatalogue>(db))
+svg::Color MakeRGBaString(const json::arena::Value& color) {
+	std::string tmp = "rgb"s;
+	if (color.AsArray().size() == 4) {
+		tmp.push_back('a');
+	}
+	tmp.push_back('(');
+	bool is_first = true;
+	for (const auto& val : color.AsArray()) {
+		if (!is_first) {
+			tmp.push_back(',');
+		}
+		std::ostringstream os;
+		os << val.AsDouble();
+		tmp += os.str();
+		is_first = false;
+	}
+	tmp.push_back(')');
+	return tmp;
+}
+
+} // namespace json_reader
+
+namespace json {
+namespace schema {
+using namespace std::literals;
+using json_reader::RequestType;
+
+template <>
+struct EnumNames<RequestType> {
+	static constexpr std::array<std::pair<std::string_view, RequestType>, 6> kNames {{
+		{"Stop"sv, RequestType::Stop},
+		{"Bus"sv, RequestType::Bus},
+		{"Route"sv, RequestType::Route},
+		{"Map"sv, RequestType::Map},
+		{"NearestStops"sv, RequestType::NearestStops},
+		{"StopsInRadius"sv, RequestType::StopsInRadius}
+	}};
+};
+
+template <>
+struct Schema<json_reader::AllRequests> {
+	using Type = json_reader::AllRequests;
+	static constexpr auto kFields = std::make_tuple(
+		Optional("base_requests"sv, &Type::base_requests),
+		Optional("remove_requests"sv, &Type::remove_requests),
+		Optional("stat_requests"sv, &Type::stat_requests),
+		Optional("render_settings"sv, &Type::render_settings),
+		Optional("routing_settings"sv, &Type::routing_settings),
+		Optional("serialization_settings"sv, &Type::serialization_settings));
+};
+
+template <>
+struct Schema<json_reader::SerializationSettings> {
+	using Type = json_reader::SerializationSettings;
+	static constexpr auto kFields = std::make_tuple(
+		Required("file"sv, &Type::file),
+		Optional("stop_order"sv, &Type::stop_order),
+		Optional("format"sv, &Type::format),
+		Optional("prerender_responses"sv, &Type::prerender_responses),
+		Optional("cache_dir"sv, &Type::cache_dir),
+		Optional("compact_encoding"sv, &Type::compact_encoding));
+};
+
+template <>
+struct Schema<json_reader::StopRequest> {
+	using Type = json_reader::StopRequest;
+	static constexpr auto kFields = std::make_tuple(
+		Required("name"sv, &Type::name),
+		Required("latitude"sv, &Type::latitude),
+		Required("longitude"sv, &Type::longitude),
+		Required("road_distances"sv, &Type::road_distances));
+};
+
+template <>
+struct Schema<json_reader::BusRequest> {
+	using Type = json_reader::BusRequest;
+	static constexpr auto kFields = std::make_tuple(
+		Required("name"sv, &Type::name),
+		Required("stops"sv, &Type::stops),
+		Required("is_roundtrip"sv, &Type::is_roundtrip));
+};
+
+template <>
+struct Schema<json_reader::RemoveRequest> {
+	using Type = json_reader::RemoveRequest;
+	static constexpr auto kFields = std::make_tuple(
+		Required("type"sv, &Type::type),
+		Required("name"sv, &Type::name));
+};
+
+template <>
+struct Schema<json_reader::InfoRequest> {
+	using Type = json_reader::InfoRequest;
+	static constexpr auto kFields = std::make_tuple(
+		Required("id"sv, &Type::id),
+		Required("name"sv, &Type::name));
+};
+
+template <>
+struct Schema<json_reader::MapRequest> {
+	using Type = json_reader::MapRequest;
+	static constexpr auto kFields = std::make_tuple(
+		Required("id"sv, &Type::id));
+};
+
+template <>
+struct Schema<json_reader::RouteRequest> {
+	using Type = json_reader::RouteRequest;
+	static constexpr auto kFields = std::make_tuple(
+		Required("id"sv, &Type::id),
+		Required("from"sv, &Type::from),
+		Required("to"sv, &Type::to));
+};
+
+template <>
+struct Schema<json_reader::NearestStopsRequest> {
+	using Type = json_reader::NearestStopsRequest;
+	static constexpr auto kFields = std::make_tuple(
+		Required("id"sv, &Type::id),
+		Required("latitude"sv, &Type::latitude),
+		Required("longitude"sv, &Type::longitude),
+		Required("count"sv, &Type::count));
+};
+
+template <>
+struct Schema<json_reader::StopsInRadiusRequest> {
+	using Type = json_reader::StopsInRadiusRequest;
+	static constexpr auto kFields = std::make_tuple(
+		Required("id"sv, &Type::id),
+		Required("latitude"sv, &Type::latitude),
+		Required("longitude"sv, &Type::longitude),
+		Required("radius"sv, &Type::radius));
+};
+
+template <>
+struct Schema<renderer::RenderSettings> {
+	using Type = renderer::RenderSettings;
+
+	static svg::Point DecodePoint(const arena::Value& value) {
+		return {value.AsArray()[0].AsDouble(), value.AsArray()[1].AsDouble()};
+	}
+
+	static svg::Color DecodeColor(const arena::Value& value) {
+		if (value.IsString()) {
+			return std::string(value.AsString());
+		}
+		return json_reader::MakeRGBaString(value);
+	}
+
+	static std::vector<svg::Color> DecodeColorPalette(const arena::Value& value) {
+		std::vector<svg::Color> palette;
+		palette.reserve(value.AsArray().size());
+		for (const auto& color : value.AsArray()) {
+			palette.push_back(DecodeColor(color));
+		}
+		return palette;
+	}
+
+	// every setting is optional, the missing ones stay zero
+	static constexpr auto kFields = std::make_tuple(
+		Optional("width"sv, &Type::width),
+		Optional("height"sv, &Type::height),
+		Optional("padding"sv, &Type::padding),
+		Optional("line_width"sv, &Type::line_width),
+		Optional("stop_radius"sv, &Type::stop_radius),
+		Optional("bus_label_font_size"sv, &Type::bus_label_font_size),
+		Optional("bus_label_offset"sv, &Type::bus_label_offset, &DecodePoint),
+		Optional("stop_label_font_size"sv, &Type::stop_label_font_size),
+		Optional("stop_label_offset"sv, &Type::stop_label_offset, &DecodePoint),
+		Optional("underlayer_color"sv, &Type::underlayer_color, &DecodeColor),
+		Optional("underlayer_width"sv, &Type::underlayer_width),
+		Optional("color_palette"sv, &Type::color_palette, &DecodeColorPalette));
+};
+
+} // namespace schema
+} // namespace json
+
+namespace json_reader {
+using json::schema::DecodeObject;
+
+JsonReader::JsonReader(data_base::TransportCatalogue &&db,
+                       router::TransportRouter& tr,
+                       std::shared_ptr<serialization::Serialization> sr)
+    : db_(std::make_unique<data_base::TransportCatalogue>(std::move(db)))
     , tr_(std::move(std::make_unique<router::TransportRouter>(tr)))
-    , sr_(std::make_shared<serialization::Serialization>(sr)) {
+    , sr_(std::move(sr)) {
 }
 
 void json_reader::JsonReader::SerializeToFileProtoDB() {
-    sr_->SerializeToFile();
+    sr_->SerializeToFile(db_);
 }
 
 void JsonReader::LoadJsonAndSetDB(std::istream& input) {
-    LoadJSON(input);
+    StreamJSONToDB(input);
 	SetDB();
     SplitAndSetRoutingSettingsByType();
     SerializeToFileProtoDB();
@@ -32,19 +219,251 @@ void json_reader::JsonReader::DeserializeAndSetDB() {
 void JsonReader::LoadRequestJSON(std::istream &input) {
     LoadJSON(input);
     DeserializeAndSetDB();
+    bus_responses_ = sr_->DeserializeBusResponses();
+    stop_responses_ = sr_->DeserializeStopResponses();
     DeserializeRoutingSettingsAndSet();
 }
 
+void JsonReader::LoadPatchAndUpdateDB(std::istream& input) {
+    LoadJSON(input);
+    DataBasePtr base = std::make_unique<data_base::TransportCatalogue>();
+    sr_->DeserializeAndSetDB(base);
+    PatchDB(*base);
+
+    // the patched base keeps the format and the encoding of the stored one
+    sr_->KeepStoredEncoding();
+    WriteDataBaseToProtoDB();
+    sr_->WriteNameIndexToProtoDB(db_->GetNameIndex());
+    sr_->WriteSpatialIndexToProtoDB(db_->GetSpatialIndex());
+    if (render_settings_) {
+        WriteRenderSettingsToProtoDB();
+    } else {
+        sr_->KeepStoredRenderSettings();
+    }
+    if (routing_settings_) {
+        SplitAndSetRoutingSettingsByType();
+    } else {
+        sr_->KeepStoredRouteSettings();
+    }
+    if (prerender_responses_ || sr_->HasStoredResponses()) {
+        WriteResponsesToProtoDB();
+    }
+    SerializeToFileProtoDB();
+}
+
+void JsonReader::PatchDB(const data_base::TransportCatalogue& base) {
+    std::unordered_set<std::string_view> removed_stops;
+    std::unordered_set<std::string_view> removed_buses;
+    if (remove_requests_) {
+        for (const auto& value : *remove_requests_) {
+            const auto request = DecodeObject<RemoveRequest>(value);
+            if (request.type == RequestType::Stop) {
+                removed_stops.insert(request.name);
+            } else if (request.type == RequestType::Bus) {
+                removed_buses.insert(request.name);
+            }
+        }
+    }
+    std::unordered_map<std::string_view, const StopRequest*> changed_stops;
+    for (const auto& stop : stops_to_db_) {
+        changed_stops[stop.name] = &stop;
+    }
+    std::unordered_map<std::string_view, const BusRequest*> changed_buses;
+    for (const auto& bus : buses_to_db_) {
+        changed_buses[bus.name] = &bus;
+    }
+
+    // kept stops and buses keep their ids, so the stored indexes stay valid
+    // unless something is added or removed; removals go first
+    bool is_moved = false;
+    for (size_t id = 0; id < base.GetStopCounts(); ++id) {
+        const domain::Stop* stored_stop = base.FindStopById(id);
+        if (removed_stops.count(stored_stop->stop_name) != 0) {
+            continue;
+        }
+        domain::Stop stop;
+        stop.stop_name = stored_stop->stop_name;
+        stop.id = db_->GetStopCounts();
+        const geo::Coordinates stored_coordinates = base.GetStopStore().GetCoordinates(id);
+        geo::Coordinates coordinates = stored_coordinates;
+        const auto changed = changed_stops.find(stop.stop_name);
+        if (changed != changed_stops.end()) {
+            coordinates = {changed->second->latitude, changed->second->longitude};
+            is_moved = is_moved || coordinates != stored_coordinates;
+        }
+        db_->AddStop(stop, coordinates);
+    }
+    for (const auto& stop : stops_to_db_) {
+        if (db_->FindStop(stop.name) == nullptr) {
+            domain::Stop stop_from;
+            stop_from.stop_name = stop.name;
+            stop_from.id = db_->GetStopCounts();
+            db_->AddStop(stop_from, {stop.latitude, stop.longitude});
+        }
+    }
+    if (!is_moved && db_->GetStopCounts() == base.GetStopCounts() && removed_stops.empty()) {
+        db_->SetSpatialIndex(base.GetSpatialIndex().GetOrder());
+    }
+
+    // a later distance overrides an earlier one, so the stored ones are set before the new ones
+    for (const auto& [from_to, length] : *base.GetAllDistances()) {
+        if (removed_stops.count(from_to.first->stop_name) == 0 && removed_stops.count(from_to.second->stop_name) == 0) {
+            db_->SetDistances(db_->FindStop(from_to.first->stop_name), db_->FindStop(from_to.second->stop_name), length);
+        }
+    }
+    SetDistancesInDB();
+
+    // info of a bus is reused if neither its route nor any of its stops changed:
+    // every distance used by a route starts or ends at a stop of the route
+    for (const domain::Bus& stored_bus : base.GetAllBuses()) {
+        if (removed_buses.count(stored_bus.bus_name) != 0) {
+            continue;
+        }
+        const auto changed = changed_buses.find(stored_bus.bus_name);
+        if (changed != changed_buses.end()) {
+            AddBusToDB(*changed->second);
+            continue;
+        }
+        domain::Bus bus;
+        bus.bus_name = stored_bus.bus_name;
+        bus.route_type = stored_bus.route_type;
+        std::vector<domain::Stop*> route;
+        bool is_touched = false;
+        for (const uint32_t stop_id : base.GetRoute(stored_bus)) {
+            const std::string_view stop_name = base.FindStopById(stop_id)->stop_name;
+            domain::Stop* stop = db_->FindStop(stop_name);
+            if (stop == nullptr) {
+                throw std::logic_error("Bus "s + std::string(bus.bus_name) + " uses removed stop "s + std::string(stop_name));
+            }
+            is_touched = is_touched || changed_stops.count(stop_name) != 0 || removed_stops.count(stop_name) != 0;
+            route.push_back(stop);
+        }
+        db_->AddBus(bus, route);
+        if (!is_touched && !route.empty()) {
+            domain::BusInfo bus_info = base.GetBusInfo(stored_bus);
+            bus_info.bus = db_->FindBus(bus.bus_name);
+            db_->SetBusInfo(bus_info);
+        }
+    }
+    for (const auto& bus : buses_to_db_) {
+        if (db_->FindBus(bus.name) == nullptr) {
+            AddBusToDB(bus);
+        }
+    }
+
+    db_->Finalize();
+    // the stored index is checked against the names and rebuilt if they changed
+    db_->Freeze(base.GetNameIndex().GetData());
+}
+
 void JsonReader::LoadJSON(std::istream& input) {
-    all_requests_ = json::Load(input).GetRoot().AsDict();
+    all_requests_ = json::arena::Load(input);
 	SplitRequestByType();
-    if (all_requests_.find("base_requests"s) != all_requests_.end()) {
+    if (base_requests_) {
         SplitBaseRequestsByType();
     }
 }
 
-void json_reader::JsonReader::WriteDistanceToProtoDB() {
-    sr_->WriteDistancesToProtoDB(db_);
+void JsonReader::StreamJSONToDB(std::istream& input) {
+    // base_requests never become a document: each request goes to the catalogue as soon
+    // as it is parsed, and SetDB only finds the stops and buses already added
+    all_requests_ = json::arena::LoadStreaming(input, "base_requests"sv, [this](const json::arena::Value& request) {
+        AddBaseRequestToDB(request);
+    });
+	SplitRequestByType();
+    AddPendingRequestsToDB();
+}
+
+void JsonReader::AddBaseRequestToDB(const json::arena::Value& request) {
+	// as in SplitBaseRequestsByType, requests after null are ignored
+	if (is_base_stream_over_ || request.IsNull()) {
+		is_base_stream_over_ = true;
+		return;
+	}
+	const json::arena::Dict dict = request.AsDict();
+	switch (json::schema::Decode<RequestType>(dict.at("type"sv))) {
+		case RequestType::Stop:
+			AddStreamedStopToDB(DecodeObject<StopRequest>(dict));
+			break;
+		case RequestType::Bus:
+			AddStreamedBusToDB(DecodeObject<BusRequest>(dict));
+			break;
+		default:
+			break;
+	}
+}
+
+void JsonReader::AddStreamedStopToDB(const StopRequest& stop) {
+	domain::Stop stop_from;
+	stop_from.stop_name = stop.name;
+	stop_from.id = db_->GetStopCounts();
+	db_->AddStop(stop_from, {stop.latitude, stop.longitude});
+	for (const auto& [stop_to, dist] : stop.road_distances) {
+		if (db_->FindStop(stop_to) != nullptr) {
+			db_->SetDistances(stop_from.stop_name, stop_to, dist.AsDouble());
+		} else {
+			pending_distances_.push_back({std::string(stop_from.stop_name), std::string(stop_to), dist.AsDouble()});
+		}
+	}
+}
+
+void JsonReader::AddStreamedBusToDB(const BusRequest& bus) {
+	const json::arena::Array& stops = bus.stops;
+	domain::Bus bus_output;
+	bus_output.bus_name = bus.name;
+	bus_output.route_type = bus.is_roundtrip ? domain::RouteType::Ring : domain::RouteType::Line;
+
+	// buses keep the input order, so every bus after a pending one waits too
+	if (pending_buses_.empty()) {
+		std::vector<domain::Stop*> route;
+		route.reserve(stops.size());
+		for (const auto& stop_name : stops) {
+			domain::Stop* stop = db_->FindStop(stop_name.AsString());
+			if (stop == nullptr) {
+				break;
+			}
+			route.push_back(stop);
+		}
+		if (route.size() == stops.size()) {
+			db_->AddBus(bus_output, route);
+			return;
+		}
+	}
+
+	PendingBus pending{std::string(bus_output.bus_name), bus_output.route_type == domain::RouteType::Ring, {}};
+	pending.stops.reserve(stops.size());
+	for (const auto& stop_name : stops) {
+		pending.stops.emplace_back(stop_name.AsString());
+	}
+	pending_buses_.push_back(std::move(pending));
+}
+
+void JsonReader::AddPendingRequestsToDB() {
+	for (const auto& [from, to, dist] : pending_distances_) {
+		db_->SetDistances(from, to, dist);
+	}
+	for (const auto& bus : pending_buses_) {
+		domain::Bus bus_output;
+		std::vector<domain::Stop*> route;
+		bus_output.bus_name = bus.name;
+		bus_output.route_type = bus.is_roundtrip ? domain::RouteType::Ring : domain::RouteType::Line;
+		for (const auto& stop_name : bus.stops) {
+			domain::Stop* stop = db_->FindStop(stop_name);
+			if (stop == nullptr) {
+				throw std::logic_error("Bus "s + bus.name + " uses unknown stop "s + stop_name);
+			}
+			route.push_back(stop);
+		}
+		db_->AddBus(bus_output, route);
+	}
+	pending_distances_.clear();
+	pending_distances_.shrink_to_fit();
+	pending_buses_.clear();
+	pending_buses_.shrink_to_fit();
+}
+
+void json_reader::JsonReader::WriteDataBaseToProtoDB() {
+    sr_->WriteDataBaseToProtoDB(db_);
 }
 
 void json_reader::JsonReader::WriteRenderSettingsToProtoDB() {
@@ -55,65 +474,120 @@ void JsonReader::SetDB() {
 	AddStopsInfoToDB();
 	SetDistancesInDB();
 	AddBusesInfoToDB();
-    WriteDistanceToProtoDB();
+    ReorderStopsInDB();
+    FinalizeDB();
+    db_->Freeze();
+    WriteDataBaseToProtoDB();
+    sr_->WriteNameIndexToProtoDB(db_->GetNameIndex());
+    sr_->WriteSpatialIndexToProtoDB(db_->GetSpatialIndex());
     WriteRenderSettingsToProtoDB();
+    if (prerender_responses_) {
+        WriteResponsesToProtoDB();
+    }
 }
 
 void JsonReader::GetCompleteOutputJSON(std::ostream& out) {
     graph::DirectedWeightedGraph<double> graph(db_->GetStopCounts());
-    tr_->FillGraph(db_, graph);
-    graph::Router router(graph);
+    const graph::Router<double> router = MakeRouter(graph);
 
-	json::Array output;
-	for (auto it = stat_requests_->begin(); it != stat_requests_->end(); ++it) {
-		int request_id = it->AsDict().at("id"s).AsInt();
-        if (it->AsDict().at("type"s) == "Stop"s) {
-            if (db_->FindStop(it->AsDict().at("name"s).AsString()) == nullptr) {
-				output.emplace_back(MakeErrorMessage(request_id));
-				continue;
+	// the array is streamed element by element, so pre-rendered answers
+	// are copied to the output as is
+	bool is_first = true;
+	auto start_element = [&out, &is_first]() {
+		if (!is_first) {
+			out << ",\n"sv;
+		}
+		is_first = false;
+		out << std::string(kResponseIndent, ' ');
+	};
+	auto output_node = [&out, &start_element](const json::Node& node) {
+		start_element();
+		json::Print(node, out, kResponseIndent);
+	};
+	auto output_response = [&out, &start_element](const domain::ResponseFragment& response, int request_id) {
+		start_element();
+		out << response.head << request_id << response.tail;
+	};
+
+	out << "[\n"sv;
+	for (const auto& value : *stat_requests_) {
+		const json::arena::Dict request = value.AsDict();
+		switch (json::schema::Decode<RequestType>(request.at("type"sv))) {
+			case RequestType::Stop: {
+				const auto info = DecodeObject<InfoRequest>(request);
+				const domain::Stop* stop = db_->FindStop(info.name);
+				if (stop == nullptr) {
+					output_node(MakeErrorMessage(info.id));
+				} else if (stop->id < stop_responses_.size()) {
+					output_response(stop_responses_[stop->id], info.id);
+				} else {
+					output_node(MakeStopInfoNode(*stop, info.id));
+				}
+				break;
 			}
-			output.emplace_back(MakeStopInfoNode(it, request_id));
-        }
-        else if (it->AsDict().at("type"s) == "Map"s) {
-            output.push_back(MakeSVGNode(request_id));
-        }
-        else if (it->AsDict().at("type"s) == "Route"s) {
-            output.emplace_back(MakeRouteInfoNode(router, it, request_id));
-        }
-        else if (it->AsDict().at("type"s) == "Bus"s) {
-            if (db_->FindBus(it->AsDict().at("name"s).AsString()) == nullptr) {
-				output.emplace_back(MakeErrorMessage(request_id));
-				continue;
+			case RequestType::Map:
+				output_node(MakeSVGNode(DecodeObject<MapRequest>(request).id));
+				break;
+			case RequestType::Route:
+				output_node(MakeRouteInfoNode(router, DecodeObject<RouteRequest>(request)));
+				break;
+			case RequestType::Bus: {
+				const auto info = DecodeObject<InfoRequest>(request);
+				const domain::Bus* bus = db_->FindBus(info.name);
+				if (bus == nullptr) {
+					output_node(MakeErrorMessage(info.id));
+				} else if (bus->id < bus_responses_.size()) {
+					output_response(bus_responses_[bus->id], info.id);
+				} else {
+					output_node(MakeBusInfoNode(*bus, info.id));
+				}
+				break;
 			}
-			output.emplace_back(MakeBusInfoNode(it, request_id));
+			case RequestType::NearestStops:
+				output_node(MakeNearestStopsNode(DecodeObject<NearestStopsRequest>(request)));
+				break;
+			case RequestType::StopsInRadius:
+				output_node(MakeStopsInRadiusNode(DecodeObject<StopsInRadiusRequest>(request)));
+				break;
+			case RequestType::Unknown:
+				break;
 		}
 	}
-	json::Document out_doc(std::move(output));
-	Print(std::move(out_doc), out);
+	out << "\n]"sv;
 }
 
 void JsonReader::MakeSVG(std::ostream& out) const {
-    renderer::MapRenderer map_renderer(std::move(GetSortedAllBusesFromDB()));
+    renderer::MapRenderer map_renderer(std::move(GetSortedAllBusesFromDB()), *db_);
     sr_->DeserializeRenderSettingsAndSetToMapRenderer(map_renderer);
 	map_renderer.SetRenderer();
 	map_renderer.OutputRenderedMap(out);
 }
 
 void JsonReader::SplitRequestByType() {
-    if (all_requests_.find("base_requests"s) != all_requests_.end()) {
-        base_requests_= &all_requests_.at("base_requests"s).AsArray();
-    }
-    if (all_requests_.find("stat_requests"s) != all_requests_.end()) {
-        stat_requests_ = &all_requests_.at("stat_requests"s).AsArray();
-    }
-    if (all_requests_.find("render_settings"s) != all_requests_.end()) {
-        render_settings_ = &all_requests_.at("render_settings"s).AsDict();
-    }
-    if (all_requests_.find("routing_settings"s) != all_requests_.end()) {
-        routing_settings_ = &all_requests_.at("routing_settings"s).AsDict();
-    }
-    if (all_requests_.find("serialization_settings"s) != all_requests_.end()) {
-        sr_->SetPathToProtoDB(all_requests_.at("serialization_settings"s).AsDict().at("file"s).AsString());
+    const auto all_requests = DecodeObject<AllRequests>(all_requests_.GetRoot());
+    base_requests_ = all_requests.base_requests;
+    remove_requests_ = all_requests.remove_requests;
+    stat_requests_ = all_requests.stat_requests;
+    render_settings_ = all_requests.render_settings;
+    routing_settings_ = all_requests.routing_settings;
+    if (all_requests.serialization_settings) {
+        const auto settings = DecodeObject<SerializationSettings>(*all_requests.serialization_settings);
+        sr_->SetPathToProtoDB(std::string(settings.file));
+        if (settings.stop_order) {
+            stop_order_ = data_base::ParseStopOrder(*settings.stop_order);
+        }
+        if (settings.format) {
+            sr_->SetBaseFormat(serialization::ParseBaseFormat(*settings.format));
+        }
+        if (settings.prerender_responses) {
+            prerender_responses_ = *settings.prerender_responses;
+        }
+        if (settings.cache_dir) {
+            cache_ = artifact_cache::ArtifactCache(std::string(*settings.cache_dir));
+        }
+        if (settings.compact_encoding) {
+            sr_->SetCompactEncoding(*settings.compact_encoding);
+        }
     }
 }
 
@@ -122,10 +596,16 @@ void JsonReader::SplitBaseRequestsByType() {
 		if (it->IsNull()) {
 			break;
 		}
-		if (it->AsDict().at("type"s) == "Stop"s) {
-			stops_to_db_.emplace_back(&(it->AsDict()));
-		} else if (it->AsDict().at("type"s) == "Bus"s) {
-			buses_to_db_.emplace_back(&(it->AsDict()));
+		const json::arena::Dict request = it->AsDict();
+		switch (json::schema::Decode<RequestType>(request.at("type"sv))) {
+			case RequestType::Stop:
+				stops_to_db_.push_back(DecodeObject<StopRequest>(request));
+				break;
+			case RequestType::Bus:
+				buses_to_db_.push_back(DecodeObject<BusRequest>(request));
+				break;
+			default:
+				break;
 		}
 	}
 }
@@ -136,6 +616,12 @@ void JsonReader::SplitAndSetRoutingSettingsByType() {
             sr_->SerializeVelocity(val.AsDouble());
 		} else if (key == "bus_wait_time"s) {
             sr_->SerializeWaitTime(val.AsDouble());
+        } else if (key == "walking_speed"s) {
+            sr_->SerializeWalkingSpeed(val.AsDouble());
+        } else if (key == "max_walking_distance"s) {
+            sr_->SerializeMaxWalkingDistance(val.AsDouble());
+        } else if (key == "max_walking_edges"s) {
+            sr_->SerializeMaxWalkingEdges(static_cast<size_t>(std::max(val.AsDouble(), 0.)));
         }
     }
 }
@@ -146,8 +632,8 @@ void JsonReader::DeserializeRoutingSettingsAndSet() {
 
 void JsonReader::SetDistancesInDB() {
     for (const auto& stop_from : stops_to_db_) {
-        for (const auto& [stop_to, dist] : stop_from->at("road_distances"s).AsDict()) {
-            db_->SetDistances(stop_from->at("name"s).AsString(), stop_to, dist.AsDouble());
+        for (const auto& [stop_to, dist] : stop_from.road_distances) {
+            db_->SetDistances(stop_from.name, stop_to, dist.AsDouble());
         }
     }
 }
@@ -159,46 +645,148 @@ void JsonReader::SerializeRenderSettings(const renderer::RenderSettings &rs) {
 void JsonReader::AddStopsInfoToDB() {
 	for (const auto& stop : stops_to_db_) {
 		domain::Stop stop_from;
-		stop_from.stop_name = stop->at("name"s).AsString();
-		stop_from.coordinates.lat = stop->at("latitude"s).AsDouble();
-        stop_from.coordinates.lng = stop->at("longitude"s).AsDouble();
+		stop_from.stop_name = stop.name;
         stop_from.id = db_->GetStopCounts();
-        sr_->WriteStopToProtoDB(stop_from);
-        db_->AddStop(std::move(stop_from));
+        db_->AddStop(stop_from, {stop.latitude, stop.longitude});
 	}
 }
 
 void JsonReader::AddBusesInfoToDB() {
 	for (const auto& bus : buses_to_db_) {
-		domain::Bus bus_output;
-		bus_output.bus_name = bus->at("name"s).AsString();
-		bus_output.route_type = bus->at("is_roundtrip"s).AsBool() ?
-					domain::RouteType::Ring : domain::RouteType::Line;
-        for (const auto& stop_name : bus->at("stops"s).AsArray()) {
-            bus_output.route_.push_back(db_->FindStop(stop_name.AsString()));
+		AddBusToDB(bus);
+    }
+}
+
+void JsonReader::AddBusToDB(const BusRequest& bus) {
+	domain::Bus bus_output;
+	std::vector<domain::Stop*> route;
+	bus_output.bus_name = bus.name;
+	bus_output.route_type = bus.is_roundtrip ?
+				domain::RouteType::Ring : domain::RouteType::Line;
+    for (const auto& stop_name : bus.stops) {
+        domain::Stop* stop = db_->FindStop(stop_name.AsString());
+        if (stop == nullptr) {
+            throw std::logic_error("Bus "s + std::string(bus.name) + " uses unknown stop "s
+                                   + std::string(stop_name.AsString()));
         }
-        sr_->WriteBusToProtoDB(bus_output);
-        db_->AddBus(std::move(bus_output));
+        route.push_back(stop);
+    }
+    db_->AddBus(bus_output, route);
+}
+
+void JsonReader::ReorderStopsInDB() {
+    if (stop_order_ == data_base::StopOrder::Hilbert) {
+        db_->ReorderStops(data_base::MakeHilbertOrder(db_->GetStopStore()));
+    } else if (stop_order_ == data_base::StopOrder::Bfs) {
+        db_->ReorderStops(data_base::MakeBfsOrder(*db_));
+    }
+}
+
+void JsonReader::FinalizeDB() {
+    if (!cache_.IsEnabled()) {
+        db_->Finalize();
+        return;
+    }
+    const uint64_t key = content_hash::HashCatalogue(*db_);
+    const std::optional<std::string> data = cache_.Load("bus_info"sv, key);
+    const bool is_cached = data && artifact_cache::DecodeBusesInfo(*data, *db_);
+    db_->Finalize();
+    if (!is_cached) {
+        cache_.Store("bus_info"sv, key, artifact_cache::EncodeBusesInfo(*db_));
+    }
+}
+
+uint64_t JsonReader::GetCatalogueHash() {
+    if (!catalogue_hash_) {
+        catalogue_hash_ = content_hash::HashCatalogue(*db_);
+    }
+    return *catalogue_hash_;
+}
+
+graph::Router<double> JsonReader::MakeRouter(graph::DirectedWeightedGraph<double>& graph) {
+    if (!cache_.IsEnabled()) {
+        tr_->FillGraph(db_, graph);
+        return graph::Router<double>(graph);
+    }
+    // the all-pairs tables depend only on the catalogue and the routing settings
+    const uint64_t key = content_hash::Hasher{}.AddValue(GetCatalogueHash()).AddValue(tr_->GetSettingsHash()).GetHash();
+    if (const std::optional<std::string> data = cache_.Load("router"sv, key)) {
+        if (auto routes = artifact_cache::DecodeRouter(*data, *db_, graph)) {
+            return graph::Router<double>(graph, std::move(*routes));
+        }
+    }
+    tr_->FillGraph(db_, graph);
+    graph::Router<double> router(graph);
+    cache_.Store("router"sv, key, artifact_cache::EncodeRouter(*db_, router));
+    return router;
+}
+
+const std::string& JsonReader::GetRenderedMap() {
+    if (rendered_map_) {
+        return *rendered_map_;
+    }
+    uint64_t key = 0;
+    if (cache_.IsEnabled()) {
+        key = content_hash::Hasher{}
+                  .AddValue(GetCatalogueHash())
+                  .AddValue(content_hash::HashRenderSettings(sr_->DeserializeRenderSettings()))
+                  .GetHash();
+        rendered_map_ = cache_.Load("map"sv, key);
+    }
+    if (!rendered_map_) {
+        std::ostringstream os;
+        MakeSVG(os);
+        rendered_map_ = os.str();
+        cache_.Store("map"sv, key, *rendered_map_);
+    }
+    return *rendered_map_;
+}
+
+void JsonReader::WriteResponsesToProtoDB() {
+    std::vector<domain::ResponseFragment> bus_responses;
+    bus_responses.reserve(db_->GetBusCounts());
+    for (const domain::Bus& bus : db_->GetAllBuses()) {
+        bus_responses.push_back(MakeResponseFragment(MakeBusInfoNode(bus, kResponsePlaceholderId)));
+    }
+    std::vector<domain::ResponseFragment> stop_responses;
+    stop_responses.reserve(db_->GetStopCounts());
+    for (size_t id = 0; id < db_->GetStopCounts(); ++id) {
+        stop_responses.push_back(MakeResponseFragment(MakeStopInfoNode(*db_->FindStopById(id), kResponsePlaceholderId)));
     }
-    db_->SetBusesInfo();
+    sr_->WriteResponsesToProtoDB(bus_responses, stop_responses);
+}
+
+domain::ResponseFragment JsonReader::MakeResponseFragment(const json::Node& response) const {
+    std::ostringstream out;
+    json::Print(response, out, kResponseIndent);
+    const std::string text = out.str();
+    // keys of the answer are one indent step deeper, each on its own line;
+    // a line break is never printed inside a string, so the slot is found unambiguously
+    const std::string slot = "\n"s + std::string(kResponseIndent + 4, ' ') + "\"request_id\": "s;
+    const size_t slot_pos = text.find(slot);
+    if (slot_pos == std::string::npos) {
+        throw std::logic_error("No request_id in a pre-rendered response"s);
+    }
+    const size_t head_size = slot_pos + slot.size();
+    // the tail starts right after the printed placeholder id
+    const size_t placeholder_size = std::to_string(kResponsePlaceholderId).size();
+    return {text.substr(0, head_size), text.substr(head_size + placeholder_size)};
 }
 
 json::Node JsonReader::MakeSVGNode(int request_id) {
-	std::ostringstream os;
-	MakeSVG(os);
 	return json::Builder{}
 			.StartDict()
-				.Key("map"s).Value(std::move(os.str()))
+				.Key("map"s).Value(GetRenderedMap())
 				.Key("request_id"s).Value(request_id)
 			.EndDict()
 			.Build();
 }
 
-json::Node JsonReader::MakeStopInfoNode(json::Array::const_iterator it, int request_id) {
-    domain::StopInfo stop_info = db_->GetStopInfo(it->AsDict().at("name"s).AsString());
+json::Node JsonReader::MakeStopInfoNode(const domain::Stop& stop, int request_id) {
+    domain::StopInfo stop_info = db_->GetStopInfo(stop);
 	std::vector<json::Node> buses;
 	for (auto it = stop_info.buses_to_stop.begin(); it != stop_info.buses_to_stop.end(); ++it) {
-		buses.emplace_back(json::Node{static_cast<std::string>(*it)});
+		buses.emplace_back(json::Node{static_cast<std::string>(db_->GetName(*it))});
 	}
 	return json::Builder{}
 			.StartDict()
@@ -208,8 +796,8 @@ json::Node JsonReader::MakeStopInfoNode(json::Array::const_iterator it, int requ
 			.Build();
 }
 
-json::Node JsonReader::MakeBusInfoNode(json::Array::const_iterator it, int request_id) {
-    domain::BusInfo bus_info = db_->GetBusInfo(it->AsDict().at("name"s).AsString());
+json::Node JsonReader::MakeBusInfoNode(const domain::Bus& bus, int request_id) {
+    domain::BusInfo bus_info = db_->GetBusInfo(bus);
 	return json::Builder{}
 			.StartDict()
 				.Key("curvature"s).Value(bus_info.curvature)
@@ -221,12 +809,40 @@ json::Node JsonReader::MakeBusInfoNode(json::Array::const_iterator it, int reque
 			.Build();
 }
 
-json::Node JsonReader::MakeRouteInfoNode(const graph::Router<double>& router,
-										 json::Array::const_iterator it,
-										 int request_id) {
+json::Node JsonReader::MakeNearestStopsNode(const NearestStopsRequest& request) {
+	const geo::Coordinates point {request.latitude, request.longitude};
+	return MakeStopDistancesNode(db_->FindNearestStops(point, std::max(request.count, 0)), request.id);
+}
+
+json::Node JsonReader::MakeStopsInRadiusNode(const StopsInRadiusRequest& request) {
+	const geo::Coordinates point {request.latitude, request.longitude};
+	return MakeStopDistancesNode(db_->FindStopsInRadius(point, request.radius), request.id);
+}
+
+json::Node JsonReader::MakeStopDistancesNode(const std::vector<domain::StopDistance>& stops, int request_id) {
+	json::Array stops_array;
+	stops_array.reserve(stops.size());
+	for (const domain::StopDistance& stop : stops) {
+		stops_array.emplace_back(json::Builder{}
+								 .StartDict()
+									.Key("name"s).Value(std::string(stop.stop->stop_name))
+									.Key("distance"s).Value(stop.distance)
+								 .EndDict()
+								 .Build());
+	}
+	return json::Builder{}
+			.StartDict()
+				.Key("request_id"s).Value(request_id)
+				.Key("stops"s).Value(std::move(stops_array))
+			.EndDict()
+			.Build();
+}
+
+json::Node JsonReader::MakeRouteInfoNode(const graph::Router<double>& router, const RouteRequest& request) {
+	const int request_id = request.id;
 	json::Array output;
-    const domain::Stop* stop_from = db_->FindStop(it->AsDict().at("from"s).AsString());
-    const domain::Stop* stop_to = db_->FindStop(it->AsDict().at("to"s).AsString());
+    const domain::Stop* stop_from = db_->FindStop(request.from);
+    const domain::Stop* stop_to = db_->FindStop(request.to);
 
 	if (stop_from == stop_to) {
 		return MakeEmptyRouteInfoMessage(request_id);
@@ -238,11 +854,19 @@ json::Node JsonReader::MakeRouteInfoNode(const graph::Router<double>& router,
 
 			for (const auto& item : route.value().edges) {
                 const auto& edge = router.GetGraph().GetEdge(item);
-                domain::Stop* stop = db_->FindStopById(edge.from);
+                const domain::Stop* stop = db_->FindStopById(edge.from);
+				if (edge.type == graph::EdgeType::Walk) {
+					output.emplace_back(std::move(
+											MakeWalkNode(edge.weight, stop->stop_name,
+														 db_->FindStopById(edge.to)->stop_name)
+											)
+										);
+					continue;
+				}
 				output.emplace_back(std::move(MakeWaitNode(wait_time, stop->stop_name)));
 				output.emplace_back(std::move(
 										MakeTripNode((edge.weight - wait_time),
-													 static_cast<int>(edge.span_count), edge.bus_name)
+													 static_cast<int>(edge.span_count), db_->GetName(edge.bus_name_id))
 										)
 									);
 			}
@@ -254,12 +878,23 @@ json::Node JsonReader::MakeRouteInfoNode(const graph::Router<double>& router,
 	return MakeErrorMessage(request_id);
 }
 
-json::Node JsonReader::MakeTripNode(double weight, int span_count, const std::string& bus_name) {
+json::Node JsonReader::MakeWalkNode(double weight, std::string_view stop_from, std::string_view stop_to) {
+	return json::Builder{}
+			.StartDict()
+			  .Key("time"s).Value(weight)
+			  .Key("from"s).Value(std::string(stop_from))
+			  .Key("to"s).Value(std::string(stop_to))
+			  .Key("type"s).Value("Walk"s)
+			.EndDict()
+			.Build();
+}
+
+json::Node JsonReader::MakeTripNode(double weight, int span_count, std::string_view bus_name) {
 	return json::Builder{}
 			.StartDict()
 			  .Key("time"s).Value(weight)
 			  .Key("span_count"s).Value(static_cast<int>(span_count))
-			  .Key("bus"s).Value(bus_name)
+			  .Key("bus"s).Value(std::string(bus_name))
 			  .Key("type"s).Value("Bus"s)
 			.EndDict()
 			.Build();
@@ -298,92 +933,18 @@ json::Node JsonReader::MakeOutputRouteInfoNode(const int request_id,
 			.Build();
 }
 
-json::Node JsonReader::MakeWaitNode(double wait_time, const std::string& stop_name) {
+json::Node JsonReader::MakeWaitNode(double wait_time, std::string_view stop_name) {
 	return json::Builder{}
 			.StartDict()
 				.Key("time"s).Value(wait_time)
-				.Key("stop_name"s).Value(stop_name)
+				.Key("stop_name"s).Value(std::string(stop_name))
 				.Key("type"s).Value("Wait"s)
 			.EndDict()
 			.Build();
 }
 
-svg::Color MakeRGBaString(json::Node color) {
-	std::string tmp = "rgb"s;
-	if (color.AsArray().size() == 4) {
-		tmp.push_back('a');
-	}
-	tmp.push_back('(');
-	bool is_first = true;
-	for (const auto& val : color.AsArray()) {
-		if (!is_first) {
-			tmp.push_back(',');
-		}
-		std::ostringstream os;
-		os << val.AsDouble();
-		tmp += os.str();
-		is_first = false;
-	}
-	tmp.push_back(')');
-	return tmp;
-}
-
 renderer::RenderSettings JsonReader::GetRenderSettings () const {
-
-    renderer::RenderSettings rs {};
-
-	for (auto it = render_settings_->begin(); it != render_settings_->end(); ++it) {
-		if (it->first == "bus_label_font_size"s) {
-			rs.bus_label_font_size = it->second.AsDouble();
-			continue;
-		} else if (it->first == "bus_label_offset"s) {
-			rs.bus_label_offset.x = it->second.AsArray()[0].AsDouble();
-			rs.bus_label_offset.y = it->second.AsArray()[1].AsDouble();
-			continue;
-		} else if (it->first == "color_palette"s) {
-			for (const auto& color : it->second.AsArray()) {
-				if (color.IsString()) {
-					rs.color_palette.push_back(std::move(color.AsString()));
-				} else {
-					rs.color_palette.push_back(std::move(MakeRGBaString(color)));
-				}
-			}
-			continue;
-		} else if (it->first == "height"s) {
-			rs.height = it->second.AsDouble();
-			continue;
-		} else if (it->first == "line_width"s) {
-			rs.line_width = it->second.AsDouble();
-			continue;
-		} else if (it->first == "padding"s) {
-			rs.padding = it->second.AsDouble();
-			continue;
-		} else if (it->first == "stop_label_font_size"s) {
-			rs.stop_label_font_size = it->second.AsDouble();
-			continue;
-		} else if (it->first == "stop_label_offset"s) {
-				rs.stop_label_offset.x = it->second.AsArray()[0].AsDouble();
-				rs.stop_label_offset.y = it->second.AsArray()[1].AsDouble();
-			continue;
-		} else if (it->first == "stop_radius"s) {
-			rs.stop_radius = it->second.AsDouble();
-			continue;
-		} else if (it->first == "underlayer_color"s) {
-			if(it->second.IsString()) {
-				rs.underlayer_color = std::move(it->second.AsString());
-			} else {
-				rs.underlayer_color = std::move(MakeRGBaString(it->second));
-			}
-			continue;
-        } else if (it->first == "underlayer_width"s) {
-            rs.underlayer_width = it->second.AsDouble();
-			continue;
-		} else if (it->first == "width"s) {
-			rs.width = it->second.AsDouble();
-			continue;
-		}
-	}
-	return rs;
+	return DecodeObject<renderer::RenderSettings>(*render_settings_);
 }
 
 std::deque<domain::Bus> JsonReader::GetSortedAllBusesFromDB() const {
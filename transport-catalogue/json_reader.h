@@ -1,32 +1,122 @@
 #pragma once
+#include "artifact_cache.h"
 #include "json.h"
+#include "json_arena.h"
+#include "json_schema.h"
 #include "map_renderer.h"
 #include "serialization.h"
+#include "stop_order.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 #include "router.h"
 #include <memory>
+#include <optional>
 #include <sstream>
+#include <string>
 
 namespace json_reader {
 using namespace std::literals;
 
+// requests are decoded from the document into the structs below by the field
+// lists in json_reader.cpp; strings, arrays and dicts point into the document
+
+enum class RequestType {
+	Unknown,
+	Stop,
+	Bus,
+	Route,
+	Map,
+	NearestStops,
+	StopsInRadius
+};
+
+// root of the input
+struct AllRequests {
+	std::optional<json::arena::Array> base_requests;
+	std::optional<json::arena::Array> remove_requests;
+	std::optional<json::arena::Array> stat_requests;
+	std::optional<json::arena::Dict> render_settings;
+	std::optional<json::arena::Dict> routing_settings;
+	std::optional<json::arena::Dict> serialization_settings;
+};
+
+struct SerializationSettings {
+	std::string_view file;
+	std::optional<std::string_view> stop_order;
+	std::optional<std::string_view> format;
+	std::optional<bool> prerender_responses;
+	std::optional<std::string_view> cache_dir;
+	std::optional<bool> compact_encoding;
+};
+
+// base requests
+struct StopRequest {
+	std::string_view name;
+	double latitude = 0.0;
+	double longitude = 0.0;
+	json::arena::Dict road_distances;
+};
+
+struct BusRequest {
+	std::string_view name;
+	json::arena::Array stops;
+	bool is_roundtrip = false;
+};
+
+struct RemoveRequest {
+	RequestType type = RequestType::Unknown;
+	std::string_view name;
+};
+
+// stat requests, Stop and Bus ones are InfoRequest
+struct InfoRequest {
+	int id = 0;
+	std::string_view name;
+};
+
+struct MapRequest {
+	int id = 0;
+};
+
+struct RouteRequest {
+	int id = 0;
+	std::string_view from;
+	std::string_view to;
+};
+
+struct NearestStopsRequest {
+	int id = 0;
+	double latitude = 0.0;
+	double longitude = 0.0;
+	int count = 0;
+};
+
+struct StopsInRadiusRequest {
+	int id = 0;
+	double latitude = 0.0;
+	double longitude = 0.0;
+	double radius = 0.0;
+};
+
 class JsonReader {
-	using RequestsArr = const json::Array*;
-	using RequestsDict = const json::Dict*;
-	using Dictionaries = std::vector<const json::Dict*>;
+	using RequestsArr = std::optional<json::arena::Array>;
+	using RequestsDict = std::optional<json::arena::Dict>;
     using DataBasePtr = std::unique_ptr<data_base::TransportCatalogue>;
 	using TransportRouterPtr = std::unique_ptr<router::TransportRouter>;
     using SerializatorPtr = std::shared_ptr<serialization::Serialization>;
 
 public:
 	JsonReader();
-    JsonReader(data_base::TransportCatalogue &db,
+    JsonReader(data_base::TransportCatalogue &&db,
                router::TransportRouter &tr,
-               serialization::Serialization &sr);
+               std::shared_ptr<serialization::Serialization> sr);
 
 	void LoadJsonAndSetDB(std::istream& input);
     void LoadRequestJSON(std::istream& input);
+    // applies a delta to the stored base and rewrites it: base_requests add or replace
+    // stops and buses, remove_requests drop them, render_settings and routing_settings
+    // replace the stored ones if given
+    void LoadPatchAndUpdateDB(std::istream& input);
     void LoadJSON(std::istream& input);
 	void SetDB();
 
@@ -38,17 +128,52 @@ private:
 	TransportRouterPtr tr_;
     SerializatorPtr sr_;
 
-	json::Dict all_requests_;
+	// requests are read from an arena document, the views below point into it
+	json::arena::Document all_requests_;
 	json::Array output_json;
 	RequestsArr base_requests_;
 	RequestsArr stat_requests_;
+	RequestsArr remove_requests_;
 	RequestsDict render_settings_;
 	RequestsDict routing_settings_;
-	Dictionaries stops_to_db_;
-	Dictionaries buses_to_db_;
+	std::vector<StopRequest> stops_to_db_;
+	std::vector<BusRequest> buses_to_db_;
+	// make_base streams base_requests into the catalogue, requests that refer to
+	// stops not read yet wait for the end of the input
+	struct PendingDistance {
+		std::string from;
+		std::string to;
+		double distance = 0.0;
+	};
+	struct PendingBus {
+		std::string name;
+		bool is_roundtrip = false;
+		std::vector<std::string> stops;
+	};
+	std::vector<PendingDistance> pending_distances_;
+	std::vector<PendingBus> pending_buses_;
+	bool is_base_stream_over_ = false;
+	data_base::StopOrder stop_order_ = data_base::StopOrder::Input;
+	bool prerender_responses_ = false;
+	// pre-rendered answers by bus and stop id, empty unless the base has them
+	std::vector<domain::ResponseFragment> bus_responses_;
+	std::vector<domain::ResponseFragment> stop_responses_;
+	artifact_cache::ArtifactCache cache_;
+	std::optional<uint64_t> catalogue_hash_;
+	std::optional<std::string> rendered_map_;
+	// indent of the elements of the output array
+	static constexpr int kResponseIndent = 4;
+	// request_id printed into a pre-rendered answer, cut out by MakeResponseFragment
+	static constexpr int kResponsePlaceholderId = 0;
 
 	void MakeSVG(std::ostream& out) const;
 
+	void StreamJSONToDB(std::istream& input);
+	void AddBaseRequestToDB(const json::arena::Value& request);
+	void AddStreamedStopToDB(const StopRequest& stop);
+	void AddStreamedBusToDB(const BusRequest& bus);
+	void AddPendingRequestsToDB();
+
 	void SplitRequestByType();
 	void SplitBaseRequestsByType();
 	void SplitAndSetRoutingSettingsByType();
@@ -56,27 +181,41 @@ private:
 
 	void AddStopsInfoToDB();
 	void AddBusesInfoToDB();
+	void AddBusToDB(const BusRequest& bus);
+	void PatchDB(const data_base::TransportCatalogue& base);
 	void SetDistancesInDB();
+	void ReorderStopsInDB();
+	// Finalize, with bus info taken from the artifact cache when the catalogue is unchanged
+	void FinalizeDB();
+	uint64_t GetCatalogueHash();
+	graph::Router<double> MakeRouter(graph::DirectedWeightedGraph<double>& graph);
+	const std::string& GetRenderedMap();
+	void WriteResponsesToProtoDB();
 
     void SerializeRenderSettings(const renderer::RenderSettings& rs);
 
 	renderer::RenderSettings GetRenderSettings() const;
 	std::deque<domain::Bus> GetSortedAllBusesFromDB() const;
 
-	json::Node MakeStopInfoNode(json::Array::const_iterator it, int request_id);
-	json::Node MakeBusInfoNode(json::Array::const_iterator it, int request_id);
-	json::Node MakeRouteInfoNode(const graph::Router<double> &router,
-								 json::Array::const_iterator it,
-								 int request_id);
+	json::Node MakeStopInfoNode(const domain::Stop& stop, int request_id);
+	json::Node MakeBusInfoNode(const domain::Bus& bus, int request_id);
+	// splits an answer printed with kResponsePlaceholderId around the id, throws std::logic_error
+	// if the answer has no request_id key
+	domain::ResponseFragment MakeResponseFragment(const json::Node& response) const;
+	json::Node MakeRouteInfoNode(const graph::Router<double> &router, const RouteRequest& request);
 	json::Node MakeSVGNode(int request_id);
+	json::Node MakeNearestStopsNode(const NearestStopsRequest& request);
+	json::Node MakeStopsInRadiusNode(const StopsInRadiusRequest& request);
+	json::Node MakeStopDistancesNode(const std::vector<domain::StopDistance>& stops, int request_id);
 	json::Node MakeErrorMessage(const int request_id);
 	json::Node MakeEmptyRouteInfoMessage(const int request_id);
 	json::Node MakeOutputRouteInfoNode(const int request_id, const json::Array& arr, const double weight);
-	json::Node MakeWaitNode(double wait_time, const std::string& stop_name);
-	json::Node MakeTripNode(double weight, int span_count, const std::string& bus_name);
+	json::Node MakeWaitNode(double wait_time, std::string_view stop_name);
+	json::Node MakeTripNode(double weight, int span_count, std::string_view bus_name);
+	json::Node MakeWalkNode(double weight, std::string_view stop_from, std::string_view stop_to);
     void SerializeToFileProtoDB();
     void DeserializeAndSetDB();
-    void WriteDistanceToProtoDB();
+    void WriteDataBaseToProtoDB();
     void WriteRenderSettingsToProtoDB();
 };
 } // namespace json_reader
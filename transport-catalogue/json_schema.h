@@ -0,0 +1,180 @@
+#pragma once
+
+#include "json_arena.h"
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace json {
+namespace schema {
+
+// Разбор словарей документа прямо в структуры. Для структуры задаётся специализация
+// Schema<Struct> с кортежем описаний полей, известным при компиляции:
+//   template <> struct Schema<Request> {
+//       static constexpr auto kFields = std::make_tuple(
+//           Required("name"sv, &Request::name),
+//           Optional("count"sv, &Request::count));
+//   };
+// DecodeObject проходит по членам словаря один раз, ключи без описания пропускаются.
+// Строки, массивы и словари в структуре указывают в документ и живут не дольше него
+
+// Разбор одного значения; для перечислений нужна специализация EnumNames
+template <typename T, typename = void>
+struct ValueDecoder;
+
+// Имена значений перечисления: static constexpr массив kNames пар (имя, значение).
+// Неизвестное имя разбирается в Enum{}
+template <typename Enum>
+struct EnumNames;
+
+template <>
+struct ValueDecoder<bool> {
+	static bool Decode(const arena::Value& value) {
+		return value.AsBool();
+	}
+};
+
+template <>
+struct ValueDecoder<int> {
+	static int Decode(const arena::Value& value) {
+		return value.AsInt();
+	}
+};
+
+template <>
+struct ValueDecoder<double> {
+	static double Decode(const arena::Value& value) {
+		return value.AsDouble();
+	}
+};
+
+template <>
+struct ValueDecoder<std::string_view> {
+	static std::string_view Decode(const arena::Value& value) {
+		return value.AsString();
+	}
+};
+
+template <>
+struct ValueDecoder<arena::Array> {
+	static arena::Array Decode(const arena::Value& value) {
+		return value.AsArray();
+	}
+};
+
+template <>
+struct ValueDecoder<arena::Dict> {
+	static arena::Dict Decode(const arena::Value& value) {
+		return value.AsDict();
+	}
+};
+
+template <typename T>
+struct ValueDecoder<std::optional<T>> {
+	static std::optional<T> Decode(const arena::Value& value) {
+		return ValueDecoder<T>::Decode(value);
+	}
+};
+
+template <typename Enum>
+struct ValueDecoder<Enum, std::enable_if_t<std::is_enum_v<Enum>>> {
+	static Enum Decode(const arena::Value& value) {
+		const std::string_view name = value.AsString();
+		for (const auto& [enum_name, enum_value] : EnumNames<Enum>::kNames) {
+			if (enum_name == name) {
+				return enum_value;
+			}
+		}
+		return Enum{};
+	}
+};
+
+template <typename Struct>
+struct Schema;
+
+template <typename Struct, typename Field>
+struct FieldDescriptor {
+	std::string_view key;
+	Field Struct::*member;
+	bool is_required;
+	Field (*decode)(const arena::Value&);
+};
+
+// Поле, без которого разбор бросает std::out_of_range, как Dict::at
+template <typename Struct, typename Field>
+constexpr FieldDescriptor<Struct, Field> Required(std::string_view key, Field Struct::*member,
+												  Field (*decode)(const arena::Value&) = &ValueDecoder<Field>::Decode) {
+	return {key, member, true, decode};
+}
+
+// Поле, которое при отсутствии ключа сохраняет значение по умолчанию
+template <typename Struct, typename Field>
+constexpr FieldDescriptor<Struct, Field> Optional(std::string_view key, Field Struct::*member,
+												  Field (*decode)(const arena::Value&) = &ValueDecoder<Field>::Decode) {
+	return {key, member, false, decode};
+}
+
+namespace detail {
+
+template <typename Struct, typename Fields, size_t... I>
+void DecodeMember(const Fields& fields, std::string_view key, const arena::Value& value, Struct& result,
+				  uint64_t& found, std::index_sequence<I...>) {
+	const auto decode = [&](const auto& field, size_t index) {
+		if (field.key != key) {
+			return false;
+		}
+		result.*field.member = field.decode(value);
+		found |= uint64_t{1} << index;
+		return true;
+	};
+	// ключи полей различны, так что срабатывает не больше одной ветки
+	static_cast<void>((decode(std::get<I>(fields), I) || ...));
+}
+
+template <typename Fields, size_t... I>
+void CheckRequired(const Fields& fields, uint64_t found, std::index_sequence<I...>) {
+	using namespace std::literals;
+	const std::pair<std::string_view, bool> keys[] = {{std::get<I>(fields).key, std::get<I>(fields).is_required}...};
+	for (size_t index = 0; index < sizeof...(I); ++index) {
+		if (keys[index].second && (found & (uint64_t{1} << index)) == 0) {
+			throw std::out_of_range("Key '"s + std::string(keys[index].first) + "' is not found"s);
+		}
+	}
+}
+
+} // namespace detail
+
+template <typename Struct>
+Struct DecodeObject(const arena::Dict& dict) {
+	constexpr auto& fields = Schema<Struct>::kFields;
+	constexpr size_t field_count = std::tuple_size_v<std::decay_t<decltype(fields)>>;
+	static_assert(field_count <= 64, "at most 64 fields are supported");
+	constexpr auto indexes = std::make_index_sequence<field_count>{};
+
+	Struct result{};
+	uint64_t found = 0;
+	for (const auto& [key, value] : dict) {
+		detail::DecodeMember(fields, key, value, result, found, indexes);
+	}
+	detail::CheckRequired(fields, found, indexes);
+	return result;
+}
+
+template <typename Struct>
+Struct DecodeObject(const arena::Value& value) {
+	return DecodeObject<Struct>(value.AsDict());
+}
+
+template <typename T>
+T Decode(const arena::Value& value) {
+	return ValueDecoder<T>::Decode(value);
+}
+
+} // namespace schema
+} // namespace json
@@ -13,8 +13,9 @@ svg::Color RenderSettings::RenderColor (int route_index) const {
 	return color_palette[route_index % color_palette.size()];
 }
 
-MapRenderer::MapRenderer(std::deque<domain::Bus> all_buses)
-	: all_buses_(std::move(all_buses)) {
+MapRenderer::MapRenderer(std::deque<domain::Bus> all_buses, const data_base::TransportCatalogue& db)
+	: all_buses_(std::move(all_buses))
+	, db_(&db) {
 }
 
 void MapRenderer::SetRenderer() {
@@ -37,26 +38,26 @@ svg::Document MapRenderer::GetRenderedMap () const {
 }
 
 void MapRenderer::MakeRouteToGeoCoordsAndStop() {
+	const data_base::StopStore& stop_store = db_->GetStopStore();
 	RouteToGeoCoords route_to_gcoords;
 	for (auto it = all_buses_.begin(); it != all_buses_.end(); ++it) {
 		route_to_gcoords.bus = &*it;
+		const data_base::TransportCatalogue::Route route = db_->GetRoute(*it);
 		std::vector<geo::Coordinates> tmp_coords;
-		std::vector<domain::Stop*> tmp_stops;
+		std::vector<const domain::Stop*> tmp_stops;
 
 		// adding stops from begin to last for both types routes
-        for (int i = 0; i < it->route_.size(); ++i) {
-			tmp_stops.push_back(it->route_[i]);
-			tmp_coords.push_back({it->route_[i]->coordinates.lat,
-								  it->route_[i]->coordinates.lng});
+        for (int i = 0; i < route.size(); ++i) {
+			tmp_stops.push_back(db_->FindStopById(route[i]));
+			tmp_coords.push_back(stop_store.GetCoordinates(route[i]));
 		}
 
 		// adding stops from last to begin for non-ring route
 		if (it->route_type == domain::RouteType::Line) {
 			route_to_gcoords.is_roundtrip = false;
-			for (int i = it->route_.size(); i > 1; --i) {
-				tmp_stops.push_back(it->route_[i - 2]);
-				tmp_coords.push_back({it->route_[i - 2]->coordinates.lat,
-									  it->route_[i - 2]->coordinates.lng});
+			for (int i = route.size(); i > 1; --i) {
+				tmp_stops.push_back(db_->FindStopById(route[i - 2]));
+				tmp_coords.push_back(stop_store.GetCoordinates(route[i - 2]));
 			}
 		} else {
 			route_to_gcoords.is_roundtrip = true;
@@ -74,7 +75,7 @@ svg::Text MapRenderer::MakeBusName(const RouteSVG& route_svg, int pos) const {
 			.SetFontSize(rs_.bus_label_font_size)
 			.SetFontWeight("bold"s)
 			.SetPosition(route_svg.route[pos].plane_coord)
-			.SetData(route_svg.bus->bus_name)
+			.SetData(std::string(route_svg.bus->bus_name))
 			.SetOffset(rs_.bus_label_offset);
 	return bus_name;
 }
@@ -86,7 +87,7 @@ svg::Text MapRenderer::MakeStopName(const StopSVG& stop) const {
 			.SetFontFamily("Verdana"s)
 			.SetFontSize(rs_.stop_label_font_size)
 			.SetPosition(stop.plane_coord)
-			.SetData(stop.stop->stop_name)
+			.SetData(std::string(stop.stop->stop_name))
 			.SetOffset(rs_.stop_label_offset);
 	return stop_name;
 }
@@ -165,9 +166,10 @@ svg::Document MapRenderer::RenderMap() const {
 
 void MapRenderer::MakeAllGeoCoordsArr() {
 	for (const auto& route_to_gcoord : routes_to_gcoords_) {
-		geo_coords_.insert(geo_coords_.end(),
-						   route_to_gcoord.geo_coords.begin(),
-						   route_to_gcoord.geo_coords.end());
+		for (const geo::Coordinates& coords : route_to_gcoord.geo_coords) {
+			geo_lats_.push_back(coords.lat);
+			geo_lngs_.push_back(coords.lng);
+		}
 	}
 }
 
@@ -204,7 +206,7 @@ RouteSVG MapRenderer::MakeRoutesBaseSVG(int route_index, const SphereProjector&
 
 void MapRenderer::MakeRoutesWithPlainCoords () {
 	const SphereProjector proj {
-		geo_coords_.begin(), geo_coords_.end(), rs_.width, rs_.height, rs_.padding
+		geo_lats_, geo_lngs_, rs_.width, rs_.height, rs_.padding
 	};
 	int routes_count = all_buses_.size();
 	for (int route_index = 0; route_index < routes_count; ++route_index) {
@@ -3,6 +3,7 @@
 #include "domain.h"
 #include "geo.h"
 #include "svg.h"
+#include "transport_catalogue.h"
 
 #include <algorithm>
 #include <cmath>
@@ -34,7 +35,7 @@ struct RenderSettings {
 };
 
 struct StopSVG {
-	domain::Stop* stop;
+	const domain::Stop* stop;
 	svg::Point plane_coord;
 };
 
@@ -46,7 +47,7 @@ struct RouteSVG {
 
 struct RouteToGeoCoords {
 	domain::Bus* bus;
-	std::vector<domain::Stop*> stops;
+	std::vector<const domain::Stop*> stops;
 	std::vector<geo::Coordinates> geo_coords;
 	bool is_roundtrip;
 };
@@ -68,15 +69,60 @@ public:
 		const auto [left_it, right_it] = std::minmax_element(
 			points_begin, points_end,
 			[](auto lhs, auto rhs) { return lhs.lng < rhs.lng; });
-		min_lon_ = left_it->lng;
-		const double max_lon = right_it->lng;
 
 		// Находим точки с минимальной и максимальной широтой
 		const auto [bottom_it, top_it] = std::minmax_element(
 			points_begin, points_end,
 			[](auto lhs, auto rhs) { return lhs.lat < rhs.lat; });
-		const double min_lat = bottom_it->lat;
-		max_lat_ = top_it->lat;
+
+		SetZoom(left_it->lng, right_it->lng, bottom_it->lat, top_it->lat, width, height);
+	}
+
+	// lats и lngs задают широты и долготы точек в виде параллельных массивов
+	SphereProjector(const std::vector<double>& lats, const std::vector<double>& lngs,
+					double width, double height, double padding)
+		: padding_(padding) //
+	{
+		if (lats.empty()) {
+			return;
+		}
+
+		// Проходы по плотным массивам без ветвлений хорошо векторизуются
+		double min_lon = lngs[0];
+		double max_lon = lngs[0];
+		for (const double lng : lngs) {
+			min_lon = std::min(min_lon, lng);
+			max_lon = std::max(max_lon, lng);
+		}
+		double min_lat = lats[0];
+		double max_lat = lats[0];
+		for (const double lat : lats) {
+			min_lat = std::min(min_lat, lat);
+			max_lat = std::max(max_lat, lat);
+		}
+
+		SetZoom(min_lon, max_lon, min_lat, max_lat, width, height);
+	}
+
+	// Проецирует широту и долготу в координаты внутри SVG-изображения
+	svg::Point operator()(geo::Coordinates coords) const {
+		return {
+			(coords.lng - min_lon_) * zoom_coeff_ + padding_,
+			(max_lat_ - coords.lat) * zoom_coeff_ + padding_
+		};
+	}
+
+private:
+	double padding_;
+	double min_lon_ = 0;
+	double max_lat_ = 0;
+	double zoom_coeff_ = 0;
+
+	void SetZoom(double min_lon, double max_lon, double min_lat, double max_lat,
+				 double width, double height) {
+		const double padding = padding_;
+		min_lon_ = min_lon;
+		max_lat_ = max_lat;
 
 		// Вычисляем коэффициент масштабирования вдоль координаты x
 		std::optional<double> width_zoom;
@@ -102,20 +148,6 @@ public:
 			zoom_coeff_ = *height_zoom;
 		}
 	}
-
-	// Проецирует широту и долготу в координаты внутри SVG-изображения
-	svg::Point operator()(geo::Coordinates coords) const {
-		return {
-			(coords.lng - min_lon_) * zoom_coeff_ + padding_,
-			(max_lat_ - coords.lat) * zoom_coeff_ + padding_
-		};
-	}
-
-private:
-	double padding_;
-	double min_lon_ = 0;
-	double max_lat_ = 0;
-	double zoom_coeff_ = 0;
 };
 
 class MapRenderer {
@@ -125,7 +157,7 @@ class MapRenderer {
 	using DrawablePtrs = std::vector<std::unique_ptr<svg::Drawable>>;
 public:
 	MapRenderer();
-    MapRenderer(std::deque<domain::Bus> all_buses);
+    MapRenderer(std::deque<domain::Bus> all_buses, const data_base::TransportCatalogue& db);
 
 	void SetRenderer();
     void SetRenderSettings(const RenderSettings& rs);
@@ -135,9 +167,11 @@ public:
 private:
 	svg::Document rendered_map_{};
 	std::deque<domain::Bus> all_buses_;
+	const data_base::TransportCatalogue* db_;
 	std::vector<StopSVG> all_stops_svg_;
 	std::vector<RouteToGeoCoords> routes_to_gcoords_;
-	GeoCoords geo_coords_ {};
+	std::vector<double> geo_lats_ {};
+	std::vector<double> geo_lngs_ {};
 	std::vector<RouteSVG> routes_svg_;
 	RenderSettings rs_;
 
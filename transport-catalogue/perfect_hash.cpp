@@ -0,0 +1,152 @@
+#include "perfect_hash.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace data_base {
+namespace {
+
+constexpr size_t kKeysPerBucket = 4;
+// with load factor 1 the last buckets find one of k free slots among n in about n / k
+// tries, so the pilot limit grows with the key count: a bucket fails with
+// probability about exp(-kPilotsPerKey)
+constexpr uint64_t kPilotsPerKey = 32;
+constexpr uint64_t kMinMaxPilot = 1 << 20;
+constexpr uint64_t kMaxSeeds = 16;
+constexpr uint32_t kFreeSlot = UINT32_MAX;
+
+uint64_t Mix(uint64_t x) {
+	// splitmix64 finalizer
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+} // namespace
+
+PerfectHash::PerfectHash(Data data)
+	: data_(std::move(data)) {
+}
+
+PerfectHash PerfectHash::Build(const std::vector<std::string_view>& keys) {
+	using namespace std::literals;
+	PerfectHash output;
+	if (keys.empty()) {
+		return output;
+	}
+	std::vector<uint64_t> hashes(keys.size());
+	for (uint64_t seed = 0; seed < kMaxSeeds; ++seed) {
+		for (size_t i = 0; i < keys.size(); ++i) {
+			hashes[i] = Hash(keys[i], seed);
+		}
+		output.data_.seed = seed;
+		if (TryBuild(hashes, output.data_)) {
+			return output;
+		}
+	}
+	// equal keys never get distinct slots, other sets fail all seeds with negligible probability
+	throw std::logic_error("Cannot build name index over "s + std::to_string(keys.size()) + " names"s);
+}
+
+std::optional<uint32_t> PerfectHash::Find(std::string_view key) const {
+	if (data_.values.empty()) {
+		return std::nullopt;
+	}
+	const uint64_t hash = Hash(key, data_.seed);
+	const uint32_t pilot = data_.pilots[GetBucket(hash, data_.pilots.size())];
+	const size_t slot = GetSlot(hash, pilot, data_.values.size());
+	if (data_.fingerprints[slot] != GetFingerprint(hash)) {
+		return std::nullopt;
+	}
+	return data_.values[slot];
+}
+
+size_t PerfectHash::GetSize() const {
+	return data_.values.size();
+}
+
+const PerfectHash::Data& PerfectHash::GetData() const {
+	return data_;
+}
+
+uint64_t PerfectHash::Hash(std::string_view key, uint64_t seed) {
+	// FNV-1a, stable between runs so the table can be stored in the base file
+	uint64_t hash = 0xcbf29ce484222325ULL ^ Mix(seed);
+	for (const char c : key) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001b3ULL;
+	}
+	return Mix(hash);
+}
+
+size_t PerfectHash::GetBucket(uint64_t hash, size_t bucket_count) {
+	return (hash >> 32) % bucket_count;
+}
+
+size_t PerfectHash::GetSlot(uint64_t hash, uint32_t pilot, size_t slot_count) {
+	return Mix(hash ^ (pilot * 0x9e3779b97f4a7c15ULL)) % slot_count;
+}
+
+uint32_t PerfectHash::GetFingerprint(uint64_t hash) {
+	return static_cast<uint32_t>(hash);
+}
+
+bool PerfectHash::TryBuild(const std::vector<uint64_t>& hashes, Data& data) {
+	const size_t key_count = hashes.size();
+	const uint32_t max_pilot = static_cast<uint32_t>(
+		std::min<uint64_t>(UINT32_MAX, std::max(kMinMaxPilot, kPilotsPerKey * key_count)));
+	data.pilots.assign((key_count + kKeysPerBucket - 1) / kKeysPerBucket, 0);
+	data.values.assign(key_count, kFreeSlot);
+	data.fingerprints.assign(key_count, 0);
+	std::vector<std::vector<uint32_t>> buckets(data.pilots.size());
+	for (uint32_t key = 0; key < key_count; ++key) {
+		buckets[GetBucket(hashes[key], buckets.size())].push_back(key);
+	}
+	// the largest buckets are placed first, while most slots are still free
+	std::vector<uint32_t> order(buckets.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t lhs, uint32_t rhs) {
+		return buckets[lhs].size() > buckets[rhs].size();
+	});
+
+	std::vector<size_t> slots;
+	for (const uint32_t bucket : order) {
+		const std::vector<uint32_t>& keys = buckets[bucket];
+		if (keys.empty()) {
+			break;
+		}
+		uint32_t pilot = 0;
+		for (; pilot < max_pilot; ++pilot) {
+			slots.clear();
+			bool is_placed = true;
+			for (const uint32_t key : keys) {
+				const size_t slot = GetSlot(hashes[key], pilot, key_count);
+				if (data.values[slot] != kFreeSlot
+					|| std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+					is_placed = false;
+					break;
+				}
+				slots.push_back(slot);
+			}
+			if (is_placed) {
+				break;
+			}
+		}
+		if (pilot == max_pilot) {
+			return false;
+		}
+		data.pilots[bucket] = pilot;
+		for (size_t i = 0; i < keys.size(); ++i) {
+			data.values[slots[i]] = keys[i];
+			data.fingerprints[slots[i]] = GetFingerprint(hashes[keys[i]]);
+		}
+	}
+	return true;
+}
+
+} // namespace data_base
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace data_base {
+
+// minimal perfect hash over a fixed set of names (hash-and-displace scheme):
+// every key is sent to a bucket, each bucket keeps a pilot that moves its keys
+// into distinct slots, a slot keeps the key value and a fingerprint of the key
+class PerfectHash {
+public:
+	struct Data {
+		uint64_t seed = 0;
+		std::vector<uint32_t> pilots;
+		std::vector<uint32_t> values;
+		std::vector<uint32_t> fingerprints;
+	};
+
+	PerfectHash() = default;
+	explicit PerfectHash(Data data);
+
+	// keys must be unique, keys[i] gets value i;
+	// throws std::logic_error if no seed gives a table
+	static PerfectHash Build(const std::vector<std::string_view>& keys);
+
+	// one probe; a miss is rejected by the fingerprint with high probability,
+	// so the caller must still compare the found key with the requested one
+	std::optional<uint32_t> Find(std::string_view key) const;
+
+	size_t GetSize() const;
+	const Data& GetData() const;
+
+private:
+	Data data_;
+
+	static uint64_t Hash(std::string_view key, uint64_t seed);
+	static size_t GetBucket(uint64_t hash, size_t bucket_count);
+	static size_t GetSlot(uint64_t hash, uint32_t pilot, size_t slot_count);
+	static uint32_t GetFingerprint(uint64_t hash);
+	static bool TryBuild(const std::vector<uint64_t>& hashes, Data& data);
+};
+
+} // namespace data_base
@@ -22,7 +22,15 @@ private:
 	using Graph = DirectedWeightedGraph<Weight>;
 
 public:
+	struct RouteInternalData {
+		Weight weight;
+		std::optional<EdgeId> prev_edge;
+	};
+	using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+
 	explicit Router(const Graph& graph);
+	// restores a router from the tables computed earlier for the same graph
+	Router(const Graph& graph, RoutesInternalData routes_internal_data);
 
 	struct RouteInfo {
 		Weight weight;
@@ -35,12 +43,11 @@ public:
 		return graph_;
 	}
 
+	const RoutesInternalData& GetRoutesInternalData() const {
+		return routes_internal_data_;
+	}
+
 private:
-	struct RouteInternalData {
-		Weight weight;
-		std::optional<EdgeId> prev_edge;
-	};
-	using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
 	void InitializeRoutesInternalData(const Graph& graph) {
 		const size_t vertex_count = graph.GetVertexCount();
@@ -100,6 +107,13 @@ Router<Weight>::Router(const Graph& graph)
 	}
 }
 
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, RoutesInternalData routes_internal_data)
+	: graph_(graph)
+	, routes_internal_data_(std::move(routes_internal_data))
+{
+}
+
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
 																			 VertexId to) const {
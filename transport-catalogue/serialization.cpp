@@ -1,188 +1,674 @@
 #include "serialization.h"
+#include "flat_base.h"
+#include "stop_order.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
 
 namespace serialization {
+namespace {
+
+bool IsIntegerDistance(double length) {
+    return length >= 0 && length <= std::numeric_limits<uint32_t>::max() && std::floor(length) == length;
+}
+
+bool IsPermutation(const google::protobuf::RepeatedField<uint32_t>& order, size_t size) {
+    if (static_cast<size_t>(order.size()) != size) {
+        return false;
+    }
+    std::vector<bool> is_seen(size, false);
+    for (uint32_t id : order) {
+        if (id >= size || is_seen[id]) {
+            return false;
+        }
+        is_seen[id] = true;
+    }
+    return true;
+}
+
+} // namespace
+
+BaseFormat ParseBaseFormat(std::string_view name) {
+    using namespace std::literals;
+    if (name == "proto"sv) {
+        return BaseFormat::Proto;
+    } else if (name == "flat"sv) {
+        return BaseFormat::Flat;
+    }
+    throw std::logic_error("Unknown base format: "s + std::string(name));
+}
+
+Serialization::Serialization()
+    : db_proto_(google::protobuf::Arena::CreateMessage<db_proto::TC>(&arena_)) {
+}
 
 void Serialization::SetPathToProtoDB(const Path &path) {
     path_ = path;
 }
 
-void Serialization::WriteDistancesToProtoDB(std::unique_ptr<data_base::TransportCatalogue>& tc) {
+void Serialization::SetBaseFormat(BaseFormat format) {
+    format_ = format;
+}
 
-    db_proto::Distance distance_proto;
-    for (const auto& distance : *tc->GetAllDistances()) {
-        distance_proto.set_from(distance.first.first->stop_name);
-        distance_proto.set_to(distance.first.second->stop_name);
-        distance_proto.set_length(distance.second);
+void Serialization::SetCompactEncoding(bool is_compact) {
+    is_compact_ = is_compact;
+}
 
-        *db_proto_.mutable_db()->add_distances() = distance_proto;
+const db_proto::TCSections& Serialization::GetSections() {
+    if (sections_) {
+        return *sections_;
+    }
+    if (const flat_base::Reader* reader = GetFlatReader()) {
+        SetSections(reader->GetSettings());
+    } else {
+        std::ifstream input(path_, std::ios::binary);
+        sections_.emplace();
+        sections_->ParseFromIstream(&input);
+    }
+    return *sections_;
+}
+
+BaseFormat Serialization::GetStoredFormat() {
+    if (!stored_format_) {
+        stored_format_ = flat_base::IsFlatBase(path_) ? BaseFormat::Flat : BaseFormat::Proto;
+        if (stored_format_ == BaseFormat::Flat) {
+            flat_reader_.emplace(path_);
+        }
     }
+    return *stored_format_;
 }
 
-void Serialization::WriteStopToProtoDB(const domain::Stop& stop) {
+const flat_base::Reader* Serialization::GetFlatReader() {
+    GetStoredFormat();
+    return flat_reader_ ? &*flat_reader_ : nullptr;
+}
 
-    db_proto::Stop stop_proto;
-    stop_proto.set_id(stop.id);
-    stop_proto.set_stop_name(stop.stop_name);
-    stop_proto.mutable_coordinates()->set_lat(stop.coordinates.lat);
-    stop_proto.mutable_coordinates()->set_lng(stop.coordinates.lng);
+void Serialization::SetSections(std::string_view data) {
+    sections_.emplace();
+    sections_->ParseFromArray(data.data(), data.size());
+}
 
-    *db_proto_.mutable_db()->add_stop() = stop_proto;
+template <typename Message>
+const Message& Serialization::DecodeSection(const std::string& data, std::optional<Message>& section) {
+    if (!section) {
+        section.emplace();
+        section->ParseFromString(data);
+    }
+    return *section;
 }
 
-void Serialization::WriteBusToProtoDB(const domain::Bus &bus) {
+void Serialization::WriteDataBaseToProtoDB(std::unique_ptr<data_base::TransportCatalogue>& tc) {
+    db_proto::DataBaseV2* db = db_proto_->mutable_db_v2();
+    size_t names_size = 0;
 
-    db_proto::Bus bus_proto;
+    const size_t stop_count = tc->GetStopCounts();
+    db->mutable_stop_names()->Reserve(stop_count);
+    for (size_t id = 0; id < stop_count; ++id) {
+        const domain::Stop* stop = tc->FindStopById(id);
+        db->add_stop_names(stop->stop_name.data(), stop->stop_name.size());
+        names_size += stop->stop_name.size();
+    }
+    if (is_compact_) {
+        WriteCompactCoordinatesToProtoDB(tc, db);
+    } else {
+        db->mutable_lats()->Reserve(stop_count);
+        db->mutable_lngs()->Reserve(stop_count);
+        const data_base::StopStore& stop_store = tc->GetStopStore();
+        for (size_t id = 0; id < stop_count; ++id) {
+            const geo::Coordinates coordinates = stop_store.GetCoordinates(id);
+            db->add_lats(coordinates.lat);
+            db->add_lngs(coordinates.lng);
+        }
+    }
 
-    bus_proto.set_bus_name(bus.bus_name);
+    const data_base::TransportCatalogue::AllBuses buses = tc->GetAllBuses();
+    size_t route_stop_count = 0;
+    for (const domain::Bus& bus : buses) {
+        route_stop_count += tc->GetRoute(bus).size();
+    }
+    db->mutable_bus_names()->Reserve(buses.size());
+    db->mutable_route_types()->Reserve(buses.size());
+    db->mutable_route_sizes()->Reserve(buses.size());
+    db->mutable_route_stops()->Reserve(route_stop_count);
+    db->mutable_bus_infos()->Reserve(buses.size());
+    for (const domain::Bus& bus : buses) {
+        db->add_bus_names(bus.bus_name.data(), bus.bus_name.size());
+        db->add_route_types(bus.route_type == domain::RouteType::Ring
+                                ? db_proto::RouteType::Ring : db_proto::RouteType::Line);
+        const data_base::TransportCatalogue::Route route = tc->GetRoute(bus);
+        db->add_route_sizes(route.size());
+        db->mutable_route_stops()->Add(route.begin(), route.end());
+        const domain::BusInfo bus_info = tc->GetBusInfo(bus);
+        db_proto::BusInfo* info_proto = db->add_bus_infos();
+        info_proto->set_unique_stops(bus_info.unique_stops);
+        info_proto->set_count_stops(bus_info.count_stops);
+        info_proto->set_geo_length(bus_info.geo_length);
+        info_proto->set_real_length(bus_info.real_length);
+        info_proto->set_curvature(bus_info.curvature);
+        names_size += bus.bus_name.size();
+    }
 
-    if (bus.route_type == domain::RouteType::Ring) {
-        bus_proto.set_route_type(db_proto::RouteType::Ring);
+    const auto& distances = *tc->GetAllDistances();
+    // lengths are kept as integers only if every one of them round-trips exactly
+    const bool is_integer_distances = is_compact_
+                                      && std::all_of(distances.begin(), distances.end(), [](const auto& distance) {
+                                             return IsIntegerDistance(distance.second);
+                                         });
+    db->mutable_distance_from()->Reserve(distances.size());
+    db->mutable_distance_to()->Reserve(distances.size());
+    if (is_integer_distances) {
+        db->mutable_distance_meters()->Reserve(distances.size());
     } else {
-        bus_proto.set_route_type(db_proto::RouteType::Line);
+        db->mutable_distance_lengths()->Reserve(distances.size());
+    }
+    for (const auto& [from_to, length] : distances) {
+        db->add_distance_from(from_to.first->id);
+        db->add_distance_to(from_to.second->id);
+        if (is_integer_distances) {
+            db->add_distance_meters(static_cast<uint32_t>(length));
+        } else {
+            db->add_distance_lengths(length);
+        }
     }
 
-    for (const auto& stop : bus.route_) {
-        bus_proto.add_route(stop->stop_name);
+    db_proto::BaseHeader* header = db_proto_->mutable_header();
+    header->set_version(kBaseVersion);
+    header->set_stop_count(stop_count);
+    header->set_bus_count(buses.size());
+    header->set_distance_count(distances.size());
+    header->set_route_stop_count(route_stop_count);
+    header->set_names_size(names_size);
+    header->set_compact_coordinates(is_compact_);
+    header->set_integer_distances(is_integer_distances);
+}
+
+void Serialization::WriteCompactCoordinatesToProtoDB(std::unique_ptr<data_base::TransportCatalogue>& tc,
+                                                     db_proto::DataBaseV2* db) {
+    const std::vector<uint32_t> order = data_base::MakeHilbertOrder(tc->GetStopStore());
+    db->mutable_lat_deltas()->Reserve(order.size());
+    db->mutable_lng_deltas()->Reserve(order.size());
+    int64_t prev_lat = 0;
+    int64_t prev_lng = 0;
+    for (uint32_t id : order) {
+        const geo::QuantizedCoordinates coordinates = geo::Quantize(tc->GetStopStore().GetCoordinates(id));
+        const int64_t lat = coordinates.lat;
+        const int64_t lng = coordinates.lng;
+        db->add_lat_deltas(static_cast<int32_t>(lat - prev_lat));
+        db->add_lng_deltas(static_cast<int32_t>(lng - prev_lng));
+        prev_lat = lat;
+        prev_lng = lng;
+    }
+    // stops already numbered in Hilbert order need no explicit order
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (order[i] != i) {
+            db->mutable_coordinate_order()->Add(order.begin(), order.end());
+            break;
+        }
     }
+}
+
+void Serialization::WriteNameIndexToProtoDB(const data_base::PerfectHash& name_index) {
+    const auto& data = name_index.GetData();
+    db_proto::NameIndex* name_index_proto = db_proto_->mutable_name_index();
+    name_index_proto->set_seed(data.seed);
+    name_index_proto->mutable_pilots()->Add(data.pilots.begin(), data.pilots.end());
+    name_index_proto->mutable_values()->Add(data.values.begin(), data.values.end());
+    name_index_proto->mutable_fingerprints()->Add(data.fingerprints.begin(), data.fingerprints.end());
+}
 
-    *db_proto_.mutable_db()->add_bus() = bus_proto;
+void Serialization::WriteSpatialIndexToProtoDB(const data_base::SpatialIndex& spatial_index) {
+    const auto& order = spatial_index.GetOrder();
+    db_proto_->mutable_spatial_index()->mutable_order()->Add(order.begin(), order.end());
+}
+
+void Serialization::WriteResponsesToProtoDB(const std::vector<domain::ResponseFragment>& bus_responses,
+                                            const std::vector<domain::ResponseFragment>& stop_responses) {
+    WriteResponsesToProto(bus_responses, db_proto_->mutable_responses()->mutable_bus());
+    WriteResponsesToProto(stop_responses, db_proto_->mutable_responses()->mutable_stop());
 }
 
 void Serialization::WriteRenderSettingsToProtoDB(const renderer::RenderSettings &rs) {
 
     // width
-    db_proto_.mutable_rs()->set_width(rs.width);
+    db_proto_->mutable_rs()->set_width(rs.width);
     // height
-    db_proto_.mutable_rs()->set_height(rs.height);
+    db_proto_->mutable_rs()->set_height(rs.height);
     // padding
-    db_proto_.mutable_rs()->set_padding(rs.padding);
+    db_proto_->mutable_rs()->set_padding(rs.padding);
     // line_width
-    db_proto_.mutable_rs()->set_line_width(rs.line_width);
+    db_proto_->mutable_rs()->set_line_width(rs.line_width);
     // stop_radius
-    db_proto_.mutable_rs()->set_stop_radius(rs.stop_radius);
+    db_proto_->mutable_rs()->set_stop_radius(rs.stop_radius);
     // bus_label_font_size
-    db_proto_.mutable_rs()->set_bus_label_font_size(rs.bus_label_font_size);
+    db_proto_->mutable_rs()->set_bus_label_font_size(rs.bus_label_font_size);
     // bus_label_offset
-    db_proto_.mutable_rs()->mutable_bus_label_offset()->set_x(rs.bus_label_offset.x);
-    db_proto_.mutable_rs()->mutable_bus_label_offset()->set_y(rs.bus_label_offset.y);
+    db_proto_->mutable_rs()->mutable_bus_label_offset()->set_x(rs.bus_label_offset.x);
+    db_proto_->mutable_rs()->mutable_bus_label_offset()->set_y(rs.bus_label_offset.y);
     // stop_label_font_size
-    db_proto_.mutable_rs()->set_stop_label_font_size(rs.stop_label_font_size);
+    db_proto_->mutable_rs()->set_stop_label_font_size(rs.stop_label_font_size);
     // stop_label_offset
-    db_proto_.mutable_rs()->mutable_stop_label_offset()->set_x(rs.stop_label_offset.x);
-    db_proto_.mutable_rs()->mutable_stop_label_offset()->set_y(rs.stop_label_offset.y);
+    db_proto_->mutable_rs()->mutable_stop_label_offset()->set_x(rs.stop_label_offset.x);
+    db_proto_->mutable_rs()->mutable_stop_label_offset()->set_y(rs.stop_label_offset.y);
     // underlayer_color
-    db_proto_.mutable_rs()->mutable_underlayer_color()->set_color_str(rs.underlayer_color);
+    db_proto_->mutable_rs()->mutable_underlayer_color()->set_color_str(rs.underlayer_color);
     // underlayer_width
-    db_proto_.mutable_rs()->set_underlayer_width(rs.underlayer_width);
+    db_proto_->mutable_rs()->set_underlayer_width(rs.underlayer_width);
     // color_palette
     for (const auto& color : rs.color_palette) {
-        db_proto::Color color_proto;
-        color_proto.set_color_str(color);
-        *db_proto_.mutable_rs()->add_color_palette() = color_proto;
+        db_proto_->mutable_rs()->add_color_palette()->set_color_str(color);
     }
 }
 
 void Serialization::DeserializeAndSetDB(std::unique_ptr<data_base::TransportCatalogue>& tc) {
+    using namespace std::literals;
+    if (const flat_base::Reader* reader = GetFlatReader()) {
+        if (!sections_) {
+            SetSections(reader->GetSettings());
+        }
+        std::future<void> responses = DecodeSettings();
+        reader->SetDB(*tc);
+        responses.get();
+        // the catalogue and sections_ keep their own copies of the data
+        flat_reader_.reset();
+        return;
+    }
 
-    std::ifstream input(path_, std::ios::binary);
+    const db_proto::TCSections& sections = GetSections();
+    db_proto::BaseHeader header;
+    if (sections.has_header()) {
+        header.ParseFromString(sections.header());
+    }
+    if (header.version() > kBaseVersion) {
+        throw std::logic_error("Unsupported base version "s + std::to_string(header.version()));
+    }
+    std::future<void> responses = DecodeSettings();
+    std::future<std::optional<data_base::PerfectHash::Data>> name_index
+        = std::async(GetLaunchPolicy(sections.name_index()), DecodeNameIndex, std::cref(sections));
+    if (header.version() >= 2) {
+        DeserializeAndSetDataBaseV2ToDB(tc, header);
+    } else {
+        DeserializeAndSetStopsToDB(tc);
+        DeserializeAndSetDistancesToDB(tc);
+        DeserializeAndSetBusesToDB(tc);
+    }
+    std::optional<data_base::PerfectHash::Data> name_index_data = name_index.get();
+    if (name_index_data) {
+        tc->Freeze(std::move(*name_index_data));
+    } else {
+        tc->Freeze();
+    }
+    responses.get();
+
+    // the catalogue keeps its own copy of the data
+    db_section_.reset();
+    sections_->clear_db();
+    sections_->clear_db_v2();
+}
 
-    db_proto_.ParseFromIstream(&input);
+std::vector<domain::ResponseFragment> Serialization::DeserializeBusResponses() {
+    return ReadResponsesFromProto(DecodeSection(GetSections().responses(), responses_section_).bus());
+}
 
-    DeserializeAndSetStopsToDB(tc);
-    DeserializeAndSetDistancesToDB(tc);
-    DeserializeAndSetBusesToDB(tc);
+std::vector<domain::ResponseFragment> Serialization::DeserializeStopResponses() {
+    return ReadResponsesFromProto(DecodeSection(GetSections().responses(), responses_section_).stop());
 }
 
 void Serialization::DeserializeRenderSettingsAndSetToMapRenderer(renderer::MapRenderer &mr) {
-    std::ifstream input(path_, std::ios::binary);
+    mr.SetRenderSettings(DeserializeRenderSettings());
+}
 
-    db_proto_.ParseFromIstream(&input);
+const renderer::RenderSettings& Serialization::DeserializeRenderSettings() {
+    if (!render_settings_) {
+        render_settings_ = DecodeRenderSettings();
+    }
+    return *render_settings_;
+}
+
+renderer::RenderSettings Serialization::DecodeRenderSettings() {
+    db_proto::RenderSettings rs_proto;
+    if (GetSections().has_rs()) {
+        rs_proto.ParseFromString(GetSections().rs());
+    }
 
     renderer::RenderSettings rs;
     // width
-    rs.width = db_proto_.rs().width();
+    rs.width = rs_proto.width();
     // height
-    rs.height = db_proto_.rs().height();
+    rs.height = rs_proto.height();
     // padding
-    rs.padding = db_proto_.rs().padding();
+    rs.padding = rs_proto.padding();
     // line_width
-    rs.line_width = db_proto_.rs().line_width();
+    rs.line_width = rs_proto.line_width();
     // stop_radius
-    rs.stop_radius = db_proto_.rs().stop_radius();
+    rs.stop_radius = rs_proto.stop_radius();
     // bus_label_font_size
-    rs.bus_label_font_size = db_proto_.rs().bus_label_font_size();
+    rs.bus_label_font_size = rs_proto.bus_label_font_size();
     // bus_label_offset
-    rs.bus_label_offset.x = db_proto_.rs().bus_label_offset().x();
-    rs.bus_label_offset.y = db_proto_.rs().bus_label_offset().y();
+    rs.bus_label_offset.x = rs_proto.bus_label_offset().x();
+    rs.bus_label_offset.y = rs_proto.bus_label_offset().y();
     // stop_label_font_size
-    rs.stop_label_font_size = db_proto_.rs().stop_label_font_size();
+    rs.stop_label_font_size = rs_proto.stop_label_font_size();
     // stop_label_offset
-    rs.stop_label_offset.x = db_proto_.rs().stop_label_offset().x();
-    rs.stop_label_offset.y = db_proto_.rs().stop_label_offset().y();
+    rs.stop_label_offset.x = rs_proto.stop_label_offset().x();
+    rs.stop_label_offset.y = rs_proto.stop_label_offset().y();
     // underlayer_color
-    rs.underlayer_color = db_proto_.rs().underlayer_color().color_str();
+    rs.underlayer_color = rs_proto.underlayer_color().color_str();
     // underlayer_width
-    rs.underlayer_width = db_proto_.rs().underlayer_width();
+    rs.underlayer_width = rs_proto.underlayer_width();
     // color_palette
-    for (const auto& color : db_proto_.rs().color_palette()) {
+    for (const auto& color : rs_proto.color_palette()) {
         rs.color_palette.push_back(color.color_str());
     }
-    mr.SetRenderSettings(rs);
+    return rs;
 }
 
 void Serialization::SerializeWaitTime(const double bus_wait_time) {
-    db_proto_.mutable_route_settings()->set_bus_wait_time(bus_wait_time);
+    db_proto_->mutable_route_settings()->set_bus_wait_time(bus_wait_time);
 }
 
 void Serialization::SerializeVelocity(const double bus_velocity) {
-    db_proto_.mutable_route_settings()->set_bus_velocity(bus_velocity);
+    db_proto_->mutable_route_settings()->set_bus_velocity(bus_velocity);
 }
 
-void Serialization::DeserializeRouteSettings(std::unique_ptr<router::TransportRouter>& tr) {
-    std::ifstream input(path_, std::ios::binary);
-    db_proto_.ParseFromIstream(&input);
+void Serialization::SerializeWalkingSpeed(const double walking_speed) {
+    db_proto_->mutable_route_settings()->set_walking_speed(walking_speed);
+}
+
+void Serialization::SerializeMaxWalkingDistance(const double max_walking_distance) {
+    db_proto_->mutable_route_settings()->set_max_walking_distance(max_walking_distance);
+}
 
-    tr->SetVelocity(db_proto_.route_settings().bus_velocity());
-    tr->SetWaitTime(db_proto_.route_settings().bus_wait_time());
+void Serialization::SerializeMaxWalkingEdges(const size_t max_walking_edges) {
+    db_proto_->mutable_route_settings()->set_max_walking_edges(max_walking_edges);
+}
+
+void Serialization::DeserializeRouteSettings(std::unique_ptr<router::TransportRouter>& tr) {
+    const db_proto::RouteSettings& route_settings = DecodeSection(GetSections().route_settings(),
+                                                                  route_settings_section_);
+    tr->SetVelocity(route_settings.bus_velocity());
+    tr->SetWaitTime(route_settings.bus_wait_time());
+    tr->SetWalkingSettings(route_settings.walking_speed(), route_settings.max_walking_distance());
+    if (route_settings.has_max_walking_edges()) {
+        tr->SetMaxWalkingEdges(route_settings.max_walking_edges());
+    }
 }
 
-void Serialization::SerializeToFile() {
+void Serialization::SerializeToFile(std::unique_ptr<data_base::TransportCatalogue>& tc) {
+    using namespace std::literals;
+    // a patched base is written over the file it was read from
+    flat_reader_.reset();
+    if (format_ == BaseFormat::Flat) {
+        if (is_compact_) {
+            throw std::logic_error("Compact encoding is not supported by the flat base format"s);
+        }
+        // the flat base keeps the catalogue in its own tables, settings stay in protobuf
+        db_proto::TC settings;
+        *settings.mutable_rs() = db_proto_->rs();
+        *settings.mutable_route_settings() = db_proto_->route_settings();
+        *settings.mutable_responses() = db_proto_->responses();
+        flat_base::Write(path_, *tc, settings);
+        return;
+    }
     std::ofstream out(path_, std::ios::binary);
-    db_proto_.SerializeToOstream(&out);
+    db_proto_->SerializeToOstream(&out);
+}
+
+void Serialization::KeepStoredEncoding() {
+    if (GetStoredFormat() == BaseFormat::Flat) {
+        format_ = BaseFormat::Flat;
+        is_compact_ = false;
+        return;
+    }
+    format_ = BaseFormat::Proto;
+    db_proto::BaseHeader header;
+    header.ParseFromString(GetSections().header());
+    is_compact_ = header.compact_coordinates();
+}
+
+void Serialization::KeepStoredRenderSettings() {
+    db_proto_->mutable_rs()->ParseFromString(GetSections().rs());
+}
+
+void Serialization::KeepStoredRouteSettings() {
+    db_proto_->mutable_route_settings()->ParseFromString(GetSections().route_settings());
+}
+
+bool Serialization::HasStoredResponses() {
+    const db_proto::Responses& responses = DecodeSection(GetSections().responses(), responses_section_);
+    return responses.bus_size() > 0 || responses.stop_size() > 0;
+}
+
+void Serialization::DeserializeAndSetDataBaseV2ToDB(std::unique_ptr<data_base::TransportCatalogue>& tc,
+                                                    const db_proto::BaseHeader& header) {
+    using namespace std::literals;
+    // the decoded tables are dropped as soon as the catalogue is filled, so they are
+    // allocated on a temporary arena sized by the encoded section
+    const std::string& data = GetSections().db_v2();
+    google::protobuf::ArenaOptions arena_options;
+    arena_options.start_block_size = std::max(data.size(), size_t{1} << 12);
+    arena_options.max_block_size = std::max(arena_options.start_block_size, arena_options.max_block_size);
+    google::protobuf::Arena arena(arena_options);
+    db_proto::DataBaseV2& db = *google::protobuf::Arena::CreateMessage<db_proto::DataBaseV2>(&arena);
+    db.ParseFromString(data);
+
+    const size_t stop_count = header.stop_count();
+    const size_t bus_count = header.bus_count();
+    const size_t distance_count = header.distance_count();
+    const auto is_stop_id = [stop_count](uint32_t id) {
+        return id < stop_count;
+    };
+    const size_t coordinate_count = header.compact_coordinates() ? db.lat_deltas_size() : db.lats_size();
+    const size_t length_count = header.integer_distances() ? db.distance_meters_size() : db.distance_lengths_size();
+    // protobuf sizes are int, the counts in the header are unsigned
+    const auto is_size = [](int size, size_t count) {
+        return static_cast<size_t>(size) == count;
+    };
+    const bool is_valid = is_size(db.stop_names_size(), stop_count) && coordinate_count == stop_count
+                          && is_size(header.compact_coordinates() ? db.lng_deltas_size() : db.lngs_size(), stop_count)
+                          && (db.coordinate_order().empty() || IsPermutation(db.coordinate_order(), stop_count))
+                          && is_size(db.bus_names_size(), bus_count) && is_size(db.route_types_size(), bus_count)
+                          && is_size(db.route_sizes_size(), bus_count) && is_size(db.bus_infos_size(), bus_count)
+                          && is_size(db.route_stops_size(), header.route_stop_count())
+                          && std::accumulate(db.route_sizes().begin(), db.route_sizes().end(), size_t{0})
+                             == header.route_stop_count()
+                          && std::all_of(db.route_stops().begin(), db.route_stops().end(), is_stop_id)
+                          && is_size(db.distance_from_size(), distance_count) && is_size(db.distance_to_size(), distance_count)
+                          && length_count == distance_count
+                          && std::all_of(db.distance_from().begin(), db.distance_from().end(), is_stop_id)
+                          && std::all_of(db.distance_to().begin(), db.distance_to().end(), is_stop_id);
+    if (!is_valid) {
+        throw std::logic_error("Broken base file: inconsistent tables"s);
+    }
+
+    tc->ReserveNames(header.names_size());
+    tc->ReserveStops(stop_count);
+    tc->ReserveBuses(bus_count, header.route_stop_count());
+    tc->ReserveDistances(distance_count);
+    const std::vector<geo::Coordinates> coordinates = ReadCoordinatesFromProto(db, header);
+    for (size_t id = 0; id < stop_count; ++id) {
+        domain::Stop stop;
+        stop.id = id;
+        stop.stop_name = db.stop_names(id);
+        tc->AddStop(stop, coordinates[id]);
+    }
+    DeserializeSpatialIndexToDB(tc);
+
+    // the distance table and the buses are filled at the same time: before Finalize
+    // they touch disjoint parts of the catalogue, and db is only read
+    const std::launch distances_policy = distance_count < kAsyncDistanceCount ? std::launch::deferred
+                                                                              : std::launch::async;
+    std::future<void> distances = std::async(distances_policy, [&tc, &db, &header, distance_count] {
+        for (size_t i = 0; i < distance_count; ++i) {
+            tc->SetDistances(tc->FindStopById(db.distance_from(i)), tc->FindStopById(db.distance_to(i)),
+                             header.integer_distances() ? db.distance_meters(i) : db.distance_lengths(i));
+        }
+    });
+
+    const uint32_t* route_begin = db.route_stops().data();
+    for (size_t id = 0; id < bus_count; ++id) {
+        domain::Bus bus;
+        bus.bus_name = db.bus_names(id);
+        bus.route_type = db.route_types(id) == db_proto::RouteType::Line
+                             ? domain::RouteType::Line : domain::RouteType::Ring;
+        const uint32_t* route_end = route_begin + db.route_sizes(id);
+        tc->AddBus(bus, data_base::TransportCatalogue::Route{route_begin, route_end});
+        if (route_begin != route_end) {
+            const db_proto::BusInfo& info_proto = db.bus_infos(id);
+            domain::BusInfo bus_info;
+            bus_info.bus = tc->FindBus(bus.bus_name);
+            bus_info.unique_stops = info_proto.unique_stops();
+            bus_info.count_stops = info_proto.count_stops();
+            bus_info.geo_length = info_proto.geo_length();
+            bus_info.real_length = info_proto.real_length();
+            bus_info.curvature = info_proto.curvature();
+            tc->SetBusInfo(bus_info);
+        }
+        route_begin = route_end;
+    }
+    distances.get();
+    tc->Finalize();
+}
+
+std::vector<geo::Coordinates> Serialization::ReadCoordinatesFromProto(const db_proto::DataBaseV2& db,
+                                                                     const db_proto::BaseHeader& header) {
+    const size_t stop_count = header.stop_count();
+    std::vector<geo::Coordinates> coordinates(stop_count);
+    if (!header.compact_coordinates()) {
+        for (size_t id = 0; id < stop_count; ++id) {
+            coordinates[id] = {db.lats(id), db.lngs(id)};
+        }
+        return coordinates;
+    }
+    int64_t lat = 0;
+    int64_t lng = 0;
+    for (size_t i = 0; i < stop_count; ++i) {
+        lat += db.lat_deltas(i);
+        lng += db.lng_deltas(i);
+        const size_t id = db.coordinate_order().empty() ? i : db.coordinate_order(i);
+        coordinates[id] = geo::Dequantize({static_cast<int32_t>(lat), static_cast<int32_t>(lng)});
+    }
+    return coordinates;
+}
+
+void Serialization::DeserializeSpatialIndexToDB(std::unique_ptr<data_base::TransportCatalogue>& tc) {
+    if (GetSections().has_spatial_index()) {
+        db_proto::SpatialIndex spatial_index;
+        spatial_index.ParseFromString(GetSections().spatial_index());
+        tc->SetSpatialIndex({spatial_index.order().begin(), spatial_index.order().end()});
+    }
 }
 
 void Serialization::DeserializeAndSetStopsToDB(std::unique_ptr<data_base::TransportCatalogue> &tc) {
-    for (size_t i = 0; i < db_proto_.db().stop_size(); ++i) {
+    const db_proto::DataBaseTC& db = DecodeSection(GetSections().db(), db_section_);
+    size_t names_size = 0;
+    for (const auto& stop : db.stop()) {
+        names_size += stop.stop_name().size();
+    }
+    for (const auto& bus : db.bus()) {
+        names_size += bus.bus_name().size();
+    }
+    tc->ReserveNames(names_size);
+    tc->ReserveStops(db.stop_size());
+    for (size_t i = 0; i < db.stop_size(); ++i) {
         domain::Stop stop;
-        stop.coordinates.lat = db_proto_.db().stop(i).coordinates().lat();
-        stop.coordinates.lng = db_proto_.db().stop(i).coordinates().lng();
-        stop.stop_name = db_proto_.db().stop(i).stop_name();
+        stop.stop_name = db.stop(i).stop_name();
         stop.id = tc->GetStopCounts();
-        tc->AddStop(stop);
+        tc->AddStop(stop, {db.stop(i).coordinates().lat(), db.stop(i).coordinates().lng()});
     }
+    DeserializeSpatialIndexToDB(tc);
 }
 
 void Serialization::DeserializeAndSetDistancesToDB(std::unique_ptr<data_base::TransportCatalogue> &tc) {
-    for (size_t i = 0; i < db_proto_.db().distances_size(); ++i) {
-        std::string_view stop_from = db_proto_.db().distances(i).from();
-        std::string_view stop_to = db_proto_.db().distances(i).to();
-        double length = db_proto_.db().distances(i).length();
+    const db_proto::DataBaseTC& db = DecodeSection(GetSections().db(), db_section_);
+    for (size_t i = 0; i < db.distances_size(); ++i) {
+        std::string_view stop_from = db.distances(i).from();
+        std::string_view stop_to = db.distances(i).to();
+        double length = db.distances(i).length();
         tc->SetDistances(stop_from, stop_to, length);
     }
 }
 
 void Serialization::DeserializeAndSetBusesToDB(std::unique_ptr<data_base::TransportCatalogue> &tc) {
-    for (size_t i = 0; i < db_proto_.db().bus_size(); ++i) {
+    const db_proto::DataBaseTC& db = DecodeSection(GetSections().db(), db_section_);
+    for (size_t i = 0; i < db.bus_size(); ++i) {
         domain::Bus bus;
-        bus.bus_name = db_proto_.db().bus(i).bus_name();
-        bus.route_type = db_proto_.db().bus(i).route_type() == db_proto::RouteType::Line
+        std::vector<domain::Stop*> route;
+        bus.bus_name = db.bus(i).bus_name();
+        bus.route_type = db.bus(i).route_type() == db_proto::RouteType::Line
                              ? domain::RouteType::Line : domain::RouteType::Ring;
-        for (const auto& stop_name : db_proto_.db().bus(i).route()) {
-            bus.route_.push_back(tc->FindStop(stop_name));
+        for (const auto& stop_name : db.bus(i).route()) {
+            route.push_back(tc->FindStop(stop_name));
+        }
+        tc->AddBus(bus, route);
+        if (db.bus(i).has_info()) {
+            // info computed by make_base spares the recomputation of route lengths
+            const db_proto::BusInfo& info_proto = db.bus(i).info();
+            domain::BusInfo bus_info;
+            bus_info.bus = tc->FindBus(bus.bus_name);
+            bus_info.unique_stops = info_proto.unique_stops();
+            bus_info.count_stops = info_proto.count_stops();
+            bus_info.geo_length = info_proto.geo_length();
+            bus_info.real_length = info_proto.real_length();
+            bus_info.curvature = info_proto.curvature();
+            tc->SetBusInfo(bus_info);
+        }
+    }
+    tc->Finalize();
+}
+
+std::future<void> Serialization::DecodeSettings() {
+    DecodeSection(sections_->route_settings(), route_settings_section_);
+    if (!render_settings_) {
+        render_settings_ = DecodeRenderSettings();
+    }
+    // the task fills only its own member, the sections themselves are only read
+    return std::async(GetLaunchPolicy(sections_->responses()), [this] {
+        if (sections_->has_responses()) {
+            DecodeSection(sections_->responses(), responses_section_);
         }
-        tc->AddBus(std::move(bus));
+    });
+}
+
+std::launch Serialization::GetLaunchPolicy(const std::string& section) {
+    return section.size() < kAsyncSectionSize ? std::launch::deferred : std::launch::async;
+}
+
+std::optional<data_base::PerfectHash::Data> Serialization::DecodeNameIndex(const db_proto::TCSections& sections) {
+    if (!sections.has_name_index()) {
+        return std::nullopt;
+    }
+    db_proto::NameIndex name_index_proto;
+    name_index_proto.ParseFromString(sections.name_index());
+    data_base::PerfectHash::Data name_index;
+    name_index.seed = name_index_proto.seed();
+    name_index.pilots.assign(name_index_proto.pilots().begin(), name_index_proto.pilots().end());
+    name_index.values.assign(name_index_proto.values().begin(), name_index_proto.values().end());
+    name_index.fingerprints.assign(name_index_proto.fingerprints().begin(), name_index_proto.fingerprints().end());
+    return name_index;
+}
+
+void Serialization::WriteResponsesToProto(const std::vector<domain::ResponseFragment>& responses,
+                                          google::protobuf::RepeatedPtrField<db_proto::ResponseFragment>* responses_proto) {
+    responses_proto->Reserve(responses.size());
+    for (const domain::ResponseFragment& response : responses) {
+        db_proto::ResponseFragment* response_proto = responses_proto->Add();
+        response_proto->set_head(response.head);
+        response_proto->set_tail(response.tail);
+    }
+}
+
+std::vector<domain::ResponseFragment>
+Serialization::ReadResponsesFromProto(const google::protobuf::RepeatedPtrField<db_proto::ResponseFragment>& responses_proto) {
+    std::vector<domain::ResponseFragment> responses;
+    responses.reserve(responses_proto.size());
+    for (const db_proto::ResponseFragment& response_proto : responses_proto) {
+        responses.push_back({response_proto.head(), response_proto.tail()});
     }
-    tc->SetBusesInfo();
+    return responses;
 }
 
 } // namespace serialization
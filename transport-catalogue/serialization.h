@@ -1,5 +1,6 @@
 #pragma once
 
+#include "flat_base.h"
 #include "map_renderer.h"
 #include "transport_catalogue.h"
 #include "transport_catalogue.pb.h"
@@ -7,38 +8,126 @@
 #include "svg.pb.h"
 #include "transport_router.h"
 
+#include <google/protobuf/arena.h>
+
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <optional>
+#include <vector>
 
 namespace serialization {
 
+// format of the file written by make_base; process_requests recognizes it by the file header
+enum class BaseFormat {
+    Proto,
+    Flat
+};
+
+// throws std::logic_error on unknown name
+BaseFormat ParseBaseFormat(std::string_view name);
+
 class Serialization {
+    // v1 bases have no header, v2 references stops by id
+    static constexpr uint32_t kBaseVersion = 2;
+    // smaller sections decode faster than a worker thread starts
+    static constexpr size_t kAsyncSectionSize = 64 * 1024;
+    // fewer distances are inserted faster than a worker thread starts
+    static constexpr size_t kAsyncDistanceCount = 16 * 1024;
     using DataBasePtr = std::shared_ptr<data_base::TransportCatalogue>;
     using Path = std::filesystem::path;
 public:
+    Serialization();
+    // the message lives on arena_, so the object is shared rather than copied
+    Serialization(const Serialization&) = delete;
+    Serialization& operator=(const Serialization&) = delete;
+
     void SetPathToProtoDB(const Path& path);
+    void SetBaseFormat(BaseFormat format);
+    // stores coordinates as micro-degrees and integer distances as varints,
+    // only the proto format supports it
+    void SetCompactEncoding(bool is_compact);
     
-    void WriteDistancesToProtoDB(std::unique_ptr<data_base::TransportCatalogue>& tc);
-    void WriteStopToProtoDB(const domain::Stop& stop);
-    void WriteBusToProtoDB(const domain::Bus& bus);
+    // writes stops, buses with their info and distances in the current (v2) schema,
+    // call after the catalogue is finalized
+    void WriteDataBaseToProtoDB(std::unique_ptr<data_base::TransportCatalogue>& tc);
+    void WriteNameIndexToProtoDB(const data_base::PerfectHash& name_index);
+    void WriteSpatialIndexToProtoDB(const data_base::SpatialIndex& spatial_index);
+    void WriteResponsesToProtoDB(const std::vector<domain::ResponseFragment>& bus_responses,
+                                 const std::vector<domain::ResponseFragment>& stop_responses);
     
     void WriteRenderSettingsToProtoDB(const renderer::RenderSettings& render_settings);
     void DeserializeRenderSettingsAndSetToMapRenderer(renderer::MapRenderer& mr);
+    const renderer::RenderSettings& DeserializeRenderSettings();
 
     void SerializeWaitTime(const double bus_wait_time);
     void SerializeVelocity(const double bus_velocity);
+    void SerializeWalkingSpeed(const double walking_speed);
+    void SerializeMaxWalkingDistance(const double max_walking_distance);
+    void SerializeMaxWalkingEdges(const size_t max_walking_edges);
     void DeserializeRouteSettings(std::unique_ptr<router::TransportRouter>& tr);
 
     void DeserializeAndSetDB(std::unique_ptr<data_base::TransportCatalogue>& tc);
+    // pre-rendered answers of the loaded base, empty if it has none
+    std::vector<domain::ResponseFragment> DeserializeBusResponses();
+    std::vector<domain::ResponseFragment> DeserializeStopResponses();
+
+    void SerializeToFile(std::unique_ptr<data_base::TransportCatalogue>& tc);
 
-    void SerializeToFile();
+    // used by patch_base to carry parts of the stored base over to the rewritten one
+    void KeepStoredEncoding();
+    void KeepStoredRenderSettings();
+    void KeepStoredRouteSettings();
+    bool HasStoredResponses();
 
 private:
     Path path_;
-    db_proto::TC db_proto_;
+    BaseFormat format_ = BaseFormat::Proto;
+    bool is_compact_ = false;
+    // written by make_base, the message and all its elements live on the arena
+    google::protobuf::Arena arena_;
+    db_proto::TC* db_proto_;
+    // read by process_requests: the file is read once, sections are decoded and cached on first use
+    std::optional<db_proto::TCSections> sections_;
+    // format of the stored file, known after the first look at it; a flat base is mapped
+    // once at that point and released when the catalogue is loaded
+    std::optional<BaseFormat> stored_format_;
+    std::optional<flat_base::Reader> flat_reader_;
+    std::optional<db_proto::DataBaseTC> db_section_;
+    std::optional<db_proto::RouteSettings> route_settings_section_;
+    std::optional<db_proto::Responses> responses_section_;
+    std::optional<renderer::RenderSettings> render_settings_;
 private:
+    // a flat base keeps only settings and responses in protobuf
+    const db_proto::TCSections& GetSections();
+    BaseFormat GetStoredFormat();
+    // nullptr unless the file is a flat base that is still mapped
+    const flat_base::Reader* GetFlatReader();
+    void SetSections(std::string_view data);
+    template <typename Message>
+    static const Message& DecodeSection(const std::string& data, std::optional<Message>& section);
+    renderer::RenderSettings DecodeRenderSettings();
+    void WriteCompactCoordinatesToProtoDB(std::unique_ptr<data_base::TransportCatalogue>& tc,
+                                          db_proto::DataBaseV2* db);
+    static std::vector<geo::Coordinates> ReadCoordinatesFromProto(const db_proto::DataBaseV2& db,
+                                                                  const db_proto::BaseHeader& header);
+    void DeserializeAndSetDataBaseV2ToDB(std::unique_ptr<data_base::TransportCatalogue>& tc,
+                                         const db_proto::BaseHeader& header);
+    void DeserializeSpatialIndexToDB(std::unique_ptr<data_base::TransportCatalogue>& tc);
     void DeserializeAndSetStopsToDB(std::unique_ptr<data_base::TransportCatalogue>& tc);
     void DeserializeAndSetDistancesToDB(std::unique_ptr<data_base::TransportCatalogue>& tc);
     void DeserializeAndSetBusesToDB(std::unique_ptr<data_base::TransportCatalogue>& tc);
+    // settings and pre-rendered answers do not depend on the catalogue: the settings are
+    // decoded in place, large answers on a worker thread while the catalogue is filled;
+    // wait for the returned future before use. sections_ must be set before the call,
+    // the worker reads it without locking
+    std::future<void> DecodeSettings();
+    // deferred decoding of small sections runs in place on get()
+    static std::launch GetLaunchPolicy(const std::string& section);
+    static std::optional<data_base::PerfectHash::Data> DecodeNameIndex(const db_proto::TCSections& sections);
+    static void WriteResponsesToProto(const std::vector<domain::ResponseFragment>& responses,
+                                      google::protobuf::RepeatedPtrField<db_proto::ResponseFragment>* responses_proto);
+    static std::vector<domain::ResponseFragment>
+    ReadResponsesFromProto(const google::protobuf::RepeatedPtrField<db_proto::ResponseFragment>& responses_proto);
 };
 } // namespace serialization
@@ -0,0 +1,189 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace data_base {
+namespace {
+
+constexpr size_t kDimensions = 3;
+
+double GetAxisValue(const geo::UnitVector& vector, size_t axis) {
+	return axis == 0 ? vector.x : axis == 1 ? vector.y : vector.z;
+}
+
+double GetAxisValue(const geo::SpherePoints& points, uint32_t id, size_t axis) {
+	return axis == 0 ? points.x[id] : axis == 1 ? points.y[id] : points.z[id];
+}
+
+} // namespace
+
+SpatialIndex::SpatialIndex(std::vector<uint32_t> order)
+	: order_(std::move(order)) {
+}
+
+SpatialIndex SpatialIndex::Build(const geo::SpherePoints& points) {
+	SpatialIndex index;
+	index.order_.resize(points.x.size());
+	std::iota(index.order_.begin(), index.order_.end(), 0);
+	index.BuildRange(points, 0, index.order_.size(), 0);
+	return index;
+}
+
+bool SpatialIndex::IsValidFor(const geo::SpherePoints& points) const {
+	if (order_.size() != points.x.size()) {
+		return false;
+	}
+	std::vector<bool> is_seen(order_.size(), false);
+	for (const uint32_t id : order_) {
+		if (id >= order_.size() || is_seen[id]) {
+			return false;
+		}
+		is_seen[id] = true;
+	}
+	return IsValidRange(points, 0, order_.size(), 0);
+}
+
+std::vector<SpatialIndex::Neighbour> SpatialIndex::FindNearest(const geo::SpherePoints& points,
+																geo::Coordinates point, size_t count) const {
+	std::vector<std::pair<double, uint32_t>> heap;
+	if (count == 0 || order_.empty()) {
+		return {};
+	}
+	heap.reserve(count + 1);
+	SearchNearest(points, geo::ToUnitVector(point), count, 0, order_.size(), 0, heap);
+	return MakeNeighbours(heap);
+}
+
+std::vector<SpatialIndex::Neighbour> SpatialIndex::FindInRadius(const geo::SpherePoints& points,
+																 geo::Coordinates point, double radius) const {
+	std::vector<std::pair<double, uint32_t>> found;
+	if (radius < 0 || order_.empty()) {
+		return {};
+	}
+	SearchInRadius(points, geo::ToUnitVector(point), geo::DistanceToChordSquare(radius),
+				   0, order_.size(), 0, found);
+	return MakeNeighbours(found);
+}
+
+size_t SpatialIndex::GetSize() const {
+	return order_.size();
+}
+
+const std::vector<uint32_t>& SpatialIndex::GetOrder() const {
+	return order_;
+}
+
+void SpatialIndex::BuildRange(const geo::SpherePoints& points, size_t begin, size_t end, size_t depth) {
+	if (end - begin <= 1) {
+		return;
+	}
+	const size_t axis = depth % kDimensions;
+	const size_t middle = begin + (end - begin) / 2;
+	std::nth_element(order_.begin() + begin, order_.begin() + middle, order_.begin() + end,
+					 [&points, axis](uint32_t lhs, uint32_t rhs) {
+		return GetAxisValue(points, lhs, axis) < GetAxisValue(points, rhs, axis);
+	});
+	BuildRange(points, begin, middle, depth + 1);
+	BuildRange(points, middle + 1, end, depth + 1);
+}
+
+bool SpatialIndex::IsValidRange(const geo::SpherePoints& points, size_t begin, size_t end, size_t depth) const {
+	if (end - begin <= 1) {
+		return true;
+	}
+	// the searches prune by the split value, so every point left of the middle
+	// must not exceed it on the split axis and every point right of it must not be below it
+	const size_t axis = depth % kDimensions;
+	const size_t middle = begin + (end - begin) / 2;
+	const double split = GetAxisValue(points, order_[middle], axis);
+	for (size_t i = begin; i < middle; ++i) {
+		if (GetAxisValue(points, order_[i], axis) > split) {
+			return false;
+		}
+	}
+	for (size_t i = middle + 1; i < end; ++i) {
+		if (GetAxisValue(points, order_[i], axis) < split) {
+			return false;
+		}
+	}
+	return IsValidRange(points, begin, middle, depth + 1) && IsValidRange(points, middle + 1, end, depth + 1);
+}
+
+void SpatialIndex::SearchNearest(const geo::SpherePoints& points, const geo::UnitVector& point, size_t count,
+								 size_t begin, size_t end, size_t depth,
+								 std::vector<std::pair<double, uint32_t>>& heap) const {
+	if (begin >= end) {
+		return;
+	}
+	const size_t middle = begin + (end - begin) / 2;
+	const uint32_t id = order_[middle];
+	const double chord_sq = geo::GetChordSquare(point, points.Get(id));
+	if (heap.size() < count || chord_sq < heap.front().first) {
+		// max-heap of the best candidates found so far
+		heap.emplace_back(chord_sq, id);
+		std::push_heap(heap.begin(), heap.end());
+		if (heap.size() > count) {
+			std::pop_heap(heap.begin(), heap.end());
+			heap.pop_back();
+		}
+	}
+
+	const size_t axis = depth % kDimensions;
+	const double delta = GetAxisValue(point, axis) - GetAxisValue(points, id, axis);
+	const bool is_left_first = delta < 0;
+	if (is_left_first) {
+		SearchNearest(points, point, count, begin, middle, depth + 1, heap);
+	} else {
+		SearchNearest(points, point, count, middle + 1, end, depth + 1, heap);
+	}
+	// the other side can hold a closer point only if the split plane is nearer than the worst candidate
+	if (heap.size() < count || delta * delta < heap.front().first) {
+		if (is_left_first) {
+			SearchNearest(points, point, count, middle + 1, end, depth + 1, heap);
+		} else {
+			SearchNearest(points, point, count, begin, middle, depth + 1, heap);
+		}
+	}
+}
+
+void SpatialIndex::SearchInRadius(const geo::SpherePoints& points, const geo::UnitVector& point, double chord_sq,
+								  size_t begin, size_t end, size_t depth,
+								  std::vector<std::pair<double, uint32_t>>& found) const {
+	if (begin >= end) {
+		return;
+	}
+	const size_t middle = begin + (end - begin) / 2;
+	const uint32_t id = order_[middle];
+	const double point_chord_sq = geo::GetChordSquare(point, points.Get(id));
+	if (point_chord_sq <= chord_sq) {
+		found.emplace_back(point_chord_sq, id);
+	}
+
+	const size_t axis = depth % kDimensions;
+	const double delta = GetAxisValue(point, axis) - GetAxisValue(points, id, axis);
+	if (delta <= 0 || delta * delta <= chord_sq) {
+		SearchInRadius(points, point, chord_sq, begin, middle, depth + 1, found);
+	}
+	if (delta >= 0 || delta * delta <= chord_sq) {
+		SearchInRadius(points, point, chord_sq, middle + 1, end, depth + 1, found);
+	}
+}
+
+std::vector<SpatialIndex::Neighbour> SpatialIndex::MakeNeighbours(std::vector<std::pair<double, uint32_t>>& found) {
+	std::sort(found.begin(), found.end());
+	std::vector<double> distances(found.size());
+	for (size_t i = 0; i < found.size(); ++i) {
+		distances[i] = found[i].first;
+	}
+	geo::ChordsToDistances(distances.data(), distances.size(), distances.data());
+
+	std::vector<Neighbour> output;
+	output.reserve(found.size());
+	for (size_t i = 0; i < found.size(); ++i) {
+		output.push_back({found[i].second, distances[i]});
+	}
+	return output;
+}
+
+} // namespace data_base
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "geo.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace data_base {
+
+// static k-d tree over points on the unit sphere. The tree is implicit:
+// the node of the range [begin, end) of order_ is its middle element, the split
+// axis alternates x, y, z with depth, so the permutation alone describes the tree;
+// the points themselves are not owned and are passed to every query
+class SpatialIndex {
+public:
+	struct Neighbour {
+		uint32_t id;
+		double distance;
+	};
+
+	SpatialIndex() = default;
+	// order must be the permutation produced by Build for the same points, see IsValidFor
+	explicit SpatialIndex(std::vector<uint32_t> order);
+
+	static SpatialIndex Build(const geo::SpherePoints& points);
+	// true if the order is a permutation of the points that satisfies the tree invariant,
+	// i.e. the tree is usable for these points whichever build produced it
+	bool IsValidFor(const geo::SpherePoints& points) const;
+
+	// count points nearest to the given one, ordered by distance
+	std::vector<Neighbour> FindNearest(const geo::SpherePoints& points,
+									   geo::Coordinates point, size_t count) const;
+	// all points not farther than radius meters, ordered by distance
+	std::vector<Neighbour> FindInRadius(const geo::SpherePoints& points,
+										geo::Coordinates point, double radius) const;
+
+	size_t GetSize() const;
+	const std::vector<uint32_t>& GetOrder() const;
+
+private:
+	std::vector<uint32_t> order_;
+
+	void BuildRange(const geo::SpherePoints& points, size_t begin, size_t end, size_t depth);
+	bool IsValidRange(const geo::SpherePoints& points, size_t begin, size_t end, size_t depth) const;
+	void SearchNearest(const geo::SpherePoints& points, const geo::UnitVector& point, size_t count,
+					   size_t begin, size_t end, size_t depth,
+					   std::vector<std::pair<double, uint32_t>>& heap) const;
+	void SearchInRadius(const geo::SpherePoints& points, const geo::UnitVector& point, double chord_sq,
+						size_t begin, size_t end, size_t depth,
+						std::vector<std::pair<double, uint32_t>>& found) const;
+	static std::vector<Neighbour> MakeNeighbours(std::vector<std::pair<double, uint32_t>>& found);
+};
+
+} // namespace data_base
@@ -0,0 +1,131 @@
+#include "stop_order.h"
+#include "transport_catalogue.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace data_base {
+namespace {
+
+constexpr uint32_t kHilbertSide = 1u << 16;
+
+// distance along the Hilbert curve filling the kHilbertSide x kHilbertSide grid
+uint64_t GetHilbertIndex(uint32_t x, uint32_t y) {
+	uint64_t index = 0;
+	for (uint32_t s = kHilbertSide / 2; s > 0; s /= 2) {
+		const uint32_t rx = (x & s) > 0;
+		const uint32_t ry = (y & s) > 0;
+		index += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+		// rotate the quadrant so the curve stays continuous
+		if (ry == 0) {
+			if (rx == 1) {
+				x = kHilbertSide - 1 - x;
+				y = kHilbertSide - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return index;
+}
+
+uint32_t ToGrid(double value, double min, double max) {
+	if (max <= min) {
+		return 0;
+	}
+	const double cell = (value - min) / (max - min) * (kHilbertSide - 1);
+	return static_cast<uint32_t>(std::clamp(cell, 0., static_cast<double>(kHilbertSide - 1)));
+}
+
+} // namespace
+
+StopOrder ParseStopOrder(std::string_view name) {
+	using namespace std::literals;
+	if (name == "input"sv) {
+		return StopOrder::Input;
+	} else if (name == "hilbert"sv) {
+		return StopOrder::Hilbert;
+	} else if (name == "bfs"sv) {
+		return StopOrder::Bfs;
+	}
+	throw std::logic_error("Unknown stop order: "s + std::string(name));
+}
+
+std::vector<uint32_t> MakeHilbertOrder(const StopStore& stop_store) {
+	std::vector<uint32_t> order(stop_store.GetSize());
+	std::iota(order.begin(), order.end(), 0);
+	if (order.empty()) {
+		return order;
+	}
+	geo::Coordinates min = stop_store.GetCoordinates(0);
+	geo::Coordinates max = min;
+	for (size_t id = 1; id < order.size(); ++id) {
+		const geo::Coordinates coordinates = stop_store.GetCoordinates(id);
+		min = {std::min(min.lat, coordinates.lat), std::min(min.lng, coordinates.lng)};
+		max = {std::max(max.lat, coordinates.lat), std::max(max.lng, coordinates.lng)};
+	}
+	std::vector<uint64_t> keys(order.size());
+	for (size_t id = 0; id < order.size(); ++id) {
+		const geo::Coordinates coordinates = stop_store.GetCoordinates(id);
+		keys[id] = GetHilbertIndex(ToGrid(coordinates.lng, min.lng, max.lng),
+								   ToGrid(coordinates.lat, min.lat, max.lat));
+	}
+	// stable, so stops in the same cell keep the input order
+	std::stable_sort(order.begin(), order.end(), [&keys](uint32_t lhs, uint32_t rhs) {
+		return keys[lhs] < keys[rhs];
+	});
+	return order;
+}
+
+std::vector<uint32_t> MakeBfsOrder(const TransportCatalogue& tc) {
+	const size_t stop_count = tc.GetStopCounts();
+	const TransportCatalogue::AllBuses buses = tc.GetAllBuses();
+
+	// stops adjacent on some route, in compressed form like the stop-to-buses index
+	std::vector<uint32_t> offsets(stop_count + 1, 0);
+	for (const domain::Bus& bus : buses) {
+		const TransportCatalogue::Route route = tc.GetRoute(bus);
+		for (size_t i = 1; i < route.size(); ++i) {
+			++offsets[route[i - 1] + 1];
+			++offsets[route[i] + 1];
+		}
+	}
+	for (size_t i = 1; i < offsets.size(); ++i) {
+		offsets[i] += offsets[i - 1];
+	}
+	std::vector<uint32_t> adjacent(offsets.back());
+	std::vector<uint32_t> fill_pos(offsets.begin(), offsets.end() - 1);
+	for (const domain::Bus& bus : buses) {
+		const TransportCatalogue::Route route = tc.GetRoute(bus);
+		for (size_t i = 1; i < route.size(); ++i) {
+			adjacent[fill_pos[route[i - 1]]++] = route[i];
+			adjacent[fill_pos[route[i]]++] = route[i - 1];
+		}
+	}
+
+	// every connected component is traversed from its stop with the least id,
+	// stops without buses keep their relative order
+	std::vector<uint32_t> order;
+	order.reserve(stop_count);
+	std::vector<bool> is_visited(stop_count, false);
+	for (uint32_t start = 0; start < stop_count; ++start) {
+		if (is_visited[start]) {
+			continue;
+		}
+		is_visited[start] = true;
+		order.push_back(start);
+		for (size_t head = order.size() - 1; head < order.size(); ++head) {
+			const uint32_t stop_id = order[head];
+			for (uint32_t i = offsets[stop_id]; i < offsets[stop_id + 1]; ++i) {
+				if (!is_visited[adjacent[i]]) {
+					is_visited[adjacent[i]] = true;
+					order.push_back(adjacent[i]);
+				}
+			}
+		}
+	}
+	return order;
+}
+
+} // namespace data_base
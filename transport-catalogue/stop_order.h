@@ -0,0 +1,28 @@
+#pragma once
+
+#include "stop_store.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace data_base {
+
+class TransportCatalogue;
+
+// order in which stop ids are assigned: stops close to each other on the map
+// (Hilbert) or on the routes (Bfs) get close ids, so their data shares cache lines
+enum class StopOrder {
+	Input,
+	Hilbert,
+	Bfs
+};
+
+// throws std::logic_error on unknown name
+StopOrder ParseStopOrder(std::string_view name);
+
+// permutations of stop ids: element N is the current id of the stop to get id N
+std::vector<uint32_t> MakeHilbertOrder(const StopStore& stop_store);
+std::vector<uint32_t> MakeBfsOrder(const TransportCatalogue& tc);
+
+} // namespace data_base
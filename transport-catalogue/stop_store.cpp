@@ -0,0 +1,41 @@
+#include "stop_store.h"
+
+namespace data_base {
+
+void StopStore::Reserve(size_t count) {
+	coordinates_.reserve(count);
+	name_ids_.reserve(count);
+	sphere_points_.Reserve(count);
+}
+
+void StopStore::Add(SymbolId name_id, geo::Coordinates coordinates) {
+	if (const auto quantized = geo::QuantizeExactly(coordinates)) {
+		coordinates_.push_back(*quantized);
+	} else {
+		exact_coordinates_[static_cast<uint32_t>(coordinates_.size())] = coordinates;
+		coordinates_.push_back({kExactCoordinates, 0});
+	}
+	name_ids_.push_back(name_id);
+	sphere_points_.Add(coordinates);
+}
+
+size_t StopStore::GetSize() const {
+	return name_ids_.size();
+}
+
+geo::Coordinates StopStore::GetCoordinates(size_t id) const {
+	if (coordinates_[id].lat == kExactCoordinates) {
+		return exact_coordinates_.at(static_cast<uint32_t>(id));
+	}
+	return geo::Dequantize(coordinates_[id]);
+}
+
+SymbolId StopStore::GetNameId(size_t id) const {
+	return name_ids_[id];
+}
+
+const geo::SpherePoints& StopStore::GetSpherePoints() const {
+	return sphere_points_;
+}
+
+} // namespace data_base
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "geo.h"
+#include "string_arena.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace data_base {
+
+// columnar storage of stops: the stop with id N is described by the N-th element
+// of every column, so geometry passes stream over packed coordinate arrays.
+// The store is the only owner of stop coordinates. They are kept as int32
+// micro-degrees, half the size of a pair of doubles and exact for input with at
+// most six decimals; the rare stops with finer coordinates keep them in a side table.
+// The unit vectors in sphere_points_ are derived from the coordinates and cost three
+// doubles per stop: the distance kernels and the spatial index read them instead
+// of evaluating sin/cos per point on every pass
+class StopStore {
+public:
+	void Reserve(size_t count);
+	void Add(SymbolId name_id, geo::Coordinates coordinates);
+
+	size_t GetSize() const;
+	geo::Coordinates GetCoordinates(size_t id) const;
+	SymbolId GetNameId(size_t id) const;
+
+	const geo::SpherePoints& GetSpherePoints() const;
+
+private:
+	// marks a stop whose coordinates are in exact_coordinates_, never a valid latitude
+	static constexpr int32_t kExactCoordinates = INT32_MIN;
+
+	std::vector<geo::QuantizedCoordinates> coordinates_;
+	std::unordered_map<uint32_t, geo::Coordinates> exact_coordinates_;
+	std::vector<SymbolId> name_ids_;
+	geo::SpherePoints sphere_points_;
+};
+
+} // namespace data_base
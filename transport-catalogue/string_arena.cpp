@@ -0,0 +1,63 @@
+#include "string_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace data_base {
+
+void StringArena::Reserve(size_t total_size) {
+	if (!blocks_.empty() && blocks_.back().capacity - blocks_.back().used >= total_size) {
+		return;
+	}
+	blocks_.push_back({std::make_unique<char[]>(total_size), total_size, 0});
+}
+
+SymbolId StringArena::Intern(std::string_view str) {
+	if (auto it = symbol_ids_.find(str); it != symbol_ids_.end()) {
+		return it->second;
+	}
+	Block& block = GetBlockFor(str.size());
+	char* dest = block.data.get() + block.used;
+	std::memcpy(dest, str.data(), str.size());
+	block.used += str.size();
+	data_size_ += str.size();
+
+	const SymbolId id = static_cast<SymbolId>(symbols_.size());
+	symbols_.emplace_back(dest, str.size());
+	symbol_ids_.emplace(symbols_.back(), id);
+	return id;
+}
+
+std::optional<SymbolId> StringArena::Find(std::string_view str) const {
+	if (auto it = symbol_ids_.find(str); it != symbol_ids_.end()) {
+		return it->second;
+	}
+	return std::nullopt;
+}
+
+std::string_view StringArena::GetName(SymbolId id) const {
+	return symbols_[id];
+}
+
+size_t StringArena::GetSymbolCount() const {
+	return symbols_.size();
+}
+
+size_t StringArena::GetDataSize() const {
+	return data_size_;
+}
+
+bool StringArena::IsContiguous() const {
+	return blocks_.size() <= 1;
+}
+
+StringArena::Block& StringArena::GetBlockFor(size_t size) {
+	if (blocks_.empty() || blocks_.back().capacity - blocks_.back().used < size) {
+		// blocks are never reallocated, so views handed out earlier stay valid
+		const size_t capacity = std::max(size, kMinBlockSize);
+		blocks_.push_back({std::make_unique<char[]>(capacity), capacity, 0});
+	}
+	return blocks_.back();
+}
+
+} // namespace data_base
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace data_base {
+
+using SymbolId = uint32_t;
+
+// storage for stop and bus names: every string is kept once, gets a small
+// integer id and is available as std::string_view valid for the arena lifetime.
+// Without Reserve names go to a chain of blocks, the catalogue packs them into
+// one block when it is frozen
+class StringArena {
+public:
+	StringArena() = default;
+	StringArena(const StringArena&) = delete;
+	StringArena& operator=(const StringArena&) = delete;
+	StringArena(StringArena&&) = default;
+	StringArena& operator=(StringArena&&) = default;
+
+	// reserves total_size bytes of names as one contiguous block
+	void Reserve(size_t total_size);
+
+	SymbolId Intern(std::string_view str);
+	std::optional<SymbolId> Find(std::string_view str) const;
+	std::string_view GetName(SymbolId id) const;
+
+	size_t GetSymbolCount() const;
+	size_t GetDataSize() const;
+	// all names are in one block
+	bool IsContiguous() const;
+
+private:
+	struct Block {
+		std::unique_ptr<char[]> data;
+		size_t capacity = 0;
+		size_t used = 0;
+	};
+	static constexpr size_t kMinBlockSize = 64 * 1024;
+
+	std::vector<Block> blocks_;
+	std::vector<std::string_view> symbols_;
+	std::unordered_map<std::string_view, SymbolId> symbol_ids_;
+	size_t data_size_ = 0;
+
+	Block& GetBlockFor(size_t size);
+};
+
+} // namespace data_base
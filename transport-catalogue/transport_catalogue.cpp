@@ -1,6 +1,9 @@
 #include "transport_catalogue.h"
 #include <iostream>
+#include <numeric>
 #include <ostream>
+#include <stdexcept>
+#include <thread>
 
 namespace data_base {
 
@@ -8,87 +11,345 @@ TransportCatalogue::TransportCatalogue()
 {
 }
 
-void TransportCatalogue::AddStop(const domain::Stop& stop) {
-	if (stopname_to_stop_.count(stop.stop_name) != 0) return;
+void TransportCatalogue::ReserveNames(size_t total_size) {
+	names_.Reserve(total_size);
+}
+
+void TransportCatalogue::ReserveStops(size_t count) {
+	stop_store_.Reserve(count);
+}
+
+void TransportCatalogue::ReserveBuses(size_t count, size_t route_stop_count) {
+	routes_.reserve(route_stop_count);
+	buses_info_.reserve(count);
+	is_bus_info_dirty_.reserve(count);
+}
+
+void TransportCatalogue::ReserveDistances(size_t count) {
+	distances_.reserve(count);
+}
+
+void TransportCatalogue::AddStop(const domain::Stop& stop, geo::Coordinates coordinates) {
+	CheckNotFrozen();
+	const SymbolId name_id = names_.Intern(stop.stop_name);
+	if (name_id < symbol_to_stop_.size() && symbol_to_stop_[name_id] != nullptr) return;
 	stops_.emplace_back(stop);
-	stopname_to_stop_.insert({stops_.back().stop_name, &stops_.back()});
+	stops_.back().stop_name = names_.GetName(name_id);
+	if (symbol_to_stop_.size() <= name_id) {
+		symbol_to_stop_.resize(name_id + 1, nullptr);
+	}
+	symbol_to_stop_[name_id] = &stops_.back();
+	stop_store_.Add(name_id, coordinates);
+}
+
+void TransportCatalogue::AddBus(const domain::Bus& bus, const std::vector<domain::Stop*>& route) {
+	std::vector<uint32_t> stop_ids;
+	stop_ids.reserve(route.size());
+	for (const domain::Stop* stop : route) {
+		stop_ids.push_back(stop->id);
+	}
+	AddBus(bus, Route{stop_ids.data(), stop_ids.data() + stop_ids.size()});
 }
 
-void TransportCatalogue::AddBus(const domain::Bus& bus) {
-	if (busname_to_bus_.count(bus.bus_name) != 0) return;
+void TransportCatalogue::AddBus(const domain::Bus& bus, Route route) {
+	CheckNotFrozen();
+	const SymbolId name_id = names_.Intern(bus.bus_name);
+	if (name_id < symbol_to_bus_.size() && symbol_to_bus_[name_id] != nullptr) return;
 	buses_.emplace_back(bus);
-	busname_to_bus_.emplace(buses_.back().bus_name, &buses_.back());
-	for (domain::Stop* stop : bus.route_) {
-		stop_to_buses_[stop].insert(&buses_.back());
+	buses_.back().id = buses_.size() - 1;
+	buses_.back().bus_name = names_.GetName(name_id);
+	buses_.back().name_id = name_id;
+	buses_.back().route_begin = routes_.size();
+	buses_.back().route_size = route.size();
+	routes_.insert(routes_.end(), route.begin(), route.end());
+	if (symbol_to_bus_.size() <= name_id) {
+		symbol_to_bus_.resize(name_id + 1, nullptr);
 	}
+	symbol_to_bus_[name_id] = &buses_.back();
+	buses_info_.emplace_back();
+	is_bus_info_dirty_.push_back(true);
+	is_stop_to_buses_stale_ = !stop_to_buses_offsets_.empty();
 }
 
 domain::Stop* TransportCatalogue::FindStop(std::string_view stop_name) const {
-	if (stopname_to_stop_.count(stop_name) == 0) {
+	const auto name_id = FindSymbol(stop_name);
+	if (!name_id || *name_id >= symbol_to_stop_.size()) {
 		return nullptr;
 	}
-	return stopname_to_stop_.find(stop_name)->second;
+	return symbol_to_stop_[*name_id];
 }
 
-domain::Stop *TransportCatalogue::FindStopById(size_t id)
-{
-	return FindStop(stops_[id].stop_name);
+const domain::Stop* TransportCatalogue::FindStopById(size_t id) const {
+	return &stops_[id];
 }
 
 domain::Bus* TransportCatalogue::FindBus(std::string_view bus_name) const {
-	if (busname_to_bus_.count(bus_name) == 0) {
+	const auto name_id = FindSymbol(bus_name);
+	if (!name_id || *name_id >= symbol_to_bus_.size()) {
 		return nullptr;
 	}
-	return busname_to_bus_.at(bus_name);
+	return symbol_to_bus_[*name_id];
+}
+
+TransportCatalogue::Route TransportCatalogue::GetRoute(const domain::Bus& bus) const {
+	const uint32_t* begin = routes_.data() + bus.route_begin;
+	return {begin, begin + bus.route_size};
 }
 
 domain::BusInfo TransportCatalogue::GetBusInfo(std::string_view bus_name) const {
-	if (buses_info_.count(bus_name) == 0) {
+	const domain::Bus* bus = FindBus(bus_name);
+	if (bus == nullptr) {
 		domain::BusInfo output {};
 		output.bus = nullptr;
 		return output;
 	}
-	return buses_info_.at(bus_name);
+	return GetBusInfo(*bus);
+}
+
+domain::BusInfo TransportCatalogue::GetBusInfo(const domain::Bus& bus) const {
+	if (buses_info_[bus.id].bus == nullptr) {
+		domain::BusInfo output {};
+		output.bus = nullptr;
+		return output;
+	}
+	return buses_info_[bus.id];
 }
 
 domain::StopInfo TransportCatalogue::GetStopInfo(std::string_view stop_name) const  {
-	domain::StopInfo output;
-	domain::Stop* stop = FindStop(stop_name);
+	const domain::Stop* stop = FindStop(stop_name);
 	if (stop == nullptr) {
+		domain::StopInfo output;
 		output.stop = nullptr;
 		return output;
 	}
-	if (stop_to_buses_.count(stop) == 0) {
-		output.stop = stop;
+	return GetStopInfo(*stop);
+}
+
+domain::StopInfo TransportCatalogue::GetStopInfo(const domain::Stop& stop) const {
+	domain::StopInfo output;
+	output.stop = &stop;
+	if (stop.id + 1 >= stop_to_buses_offsets_.size()) {
 		output.no_bus = true;
 		return output;
 	}
-	for (const domain::Bus* bus : stop_to_buses_.at(stop)) {
-		output.buses_to_stop.push_back(bus->bus_name);
+	const uint32_t begin = stop_to_buses_offsets_[stop.id];
+	const uint32_t end = stop_to_buses_offsets_[stop.id + 1];
+	output.buses_to_stop.reserve(end - begin);
+	for (uint32_t i = begin; i < end; ++i) {
+		output.buses_to_stop.push_back(buses_[stop_to_buses_[i]].name_id);
 	}
-	std::sort(output.buses_to_stop.begin(), output.buses_to_stop.end());
-	output.stop = stop;
-	output.no_bus = false;
+	output.no_bus = output.buses_to_stop.empty();
 	return output;
 }
 
+std::string_view TransportCatalogue::GetName(SymbolId id) const {
+	return names_.GetName(id);
+}
+
 void data_base::TransportCatalogue::SetDistances (std::string_view from, std::string_view to, double dist) {
-	domain::Stop* stop_from = FindStop(from);
-	domain::Stop* stop_to = FindStop(to);
-	if (distances_.count({stop_to, stop_from}) != 0) {
-		if (distances_.at({stop_to, stop_from}) == dist) {
+	SetDistances(FindStop(from), FindStop(to), dist);
+}
+
+void TransportCatalogue::SetDistances (const domain::Stop* stop_from, const domain::Stop* stop_to, double dist) {
+	CheckNotFrozen();
+	const auto forward = distances_.find({stop_from, stop_to});
+	if (forward != distances_.end() && forward->second == dist) {
+		return;
+	}
+	// the reverse distance stands for this one when they are equal
+	const auto reverse = distances_.find({stop_to, stop_from});
+	if (reverse != distances_.end() && reverse->second == dist) {
+		if (forward == distances_.end()) {
 			return;
 		}
+		distances_.erase(forward);
+	} else {
+		distances_.insert_or_assign({stop_from, stop_to}, dist);
 	}
-	distances_.insert({{stop_from, stop_to}, dist});
+	// the distance has changed, so the info of every bus through its stops is outdated
+	MarkBusesInfoDirty(stop_from);
+	MarkBusesInfoDirty(stop_to);
 }
 
 void TransportCatalogue::SetBusesInfo() {
-	for(const auto& [_, bus] : busname_to_bus_) {
-		if (!bus->route_.empty()) {
-			MakeBusInfo(bus);
+	std::vector<const domain::Bus*> dirty_buses;
+	for (const domain::Bus& bus : buses_) {
+		if (!is_bus_info_dirty_[bus.id]) {
+			continue;
+		}
+		is_bus_info_dirty_[bus.id] = false;
+		if (bus.route_size != 0) {
+			dirty_buses.push_back(&bus);
+		} else {
+			buses_info_[bus.id] = {};
+			buses_info_[bus.id].bus = nullptr;
+		}
+	}
+
+	// workers write to distinct elements of buses_info_ and only read the rest
+	constexpr size_t kMinBusesPerThread = 64;
+	const size_t thread_count = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(),
+																	  dirty_buses.size() / kMinBusesPerThread));
+	auto make_buses_info = [this, &dirty_buses, thread_count](size_t worker) {
+		std::vector<bool> is_seen(stops_.size(), false);
+		for (size_t i = worker; i < dirty_buses.size(); i += thread_count) {
+			buses_info_[dirty_buses[i]->id] = MakeBusInfo(dirty_buses[i], is_seen);
 		}
+	};
+	std::vector<std::thread> workers;
+	workers.reserve(thread_count - 1);
+	for (size_t worker = 1; worker < thread_count; ++worker) {
+		workers.emplace_back(make_buses_info, worker);
+	}
+	make_buses_info(0);
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void TransportCatalogue::ReorderStops(const std::vector<uint32_t>& order) {
+	using namespace std::literals;
+	CheckNotFrozen();
+	if (order.size() != stops_.size()) {
+		throw std::logic_error("Stop order must cover all stops"s);
+	}
+	constexpr uint32_t kNoId = UINT32_MAX;
+	std::vector<uint32_t> new_ids(stops_.size(), kNoId);
+	for (uint32_t new_id = 0; new_id < order.size(); ++new_id) {
+		if (order[new_id] >= new_ids.size() || new_ids[order[new_id]] != kNoId) {
+			throw std::logic_error("Stop order must be a permutation"s);
+		}
+		new_ids[order[new_id]] = new_id;
+	}
+
+	// the deque slots stay in place and only their contents move,
+	// so every pointer to a stop is redirected to the slot of its new id
+	Distances distances;
+	distances.reserve(distances_.size());
+	for (const auto& [from_to, distance] : distances_) {
+		distances.insert({{&stops_[new_ids[from_to.first->id]], &stops_[new_ids[from_to.second->id]]}, distance});
+	}
+	distances_ = std::move(distances);
+
+	const AllStops stops = stops_;
+	for (uint32_t new_id = 0; new_id < order.size(); ++new_id) {
+		stops_[new_id] = stops[order[new_id]];
+		stops_[new_id].id = new_id;
+	}
+	for (uint32_t& stop_id : routes_) {
+		stop_id = new_ids[stop_id];
+	}
+	RebuildNamesAndStopStore(order);
+	spatial_index_ = {};
+	stop_to_buses_offsets_.clear();
+	stop_to_buses_.clear();
+}
+
+bool TransportCatalogue::HasLoadOrderNames() const {
+	// ids are given out on first appearance, stops by id and then buses
+	SymbolId next_id = 0;
+	const auto is_in_order = [this, &next_id](std::string_view name) {
+		const SymbolId name_id = *names_.Find(name);
+		if (name_id == next_id) {
+			++next_id;
+			return true;
+		}
+		return name_id < next_id;
+	};
+	return std::all_of(stops_.begin(), stops_.end(), [&is_in_order](const domain::Stop& stop) {
+			   return is_in_order(stop.stop_name);
+		   })
+		&& std::all_of(buses_.begin(), buses_.end(), [&is_in_order](const domain::Bus& bus) {
+			   return is_in_order(bus.bus_name);
+		   });
+}
+
+void TransportCatalogue::RebuildNamesAndStopStore(const std::vector<uint32_t>& old_ids) {
+	// names are interned anew in the order a loaded base adds them, stops by id and then buses,
+	// so a stored name index keeps matching the symbol ids after loading
+	StringArena names;
+	names.Reserve(names_.GetDataSize());
+	StopStore stop_store;
+	stop_store.Reserve(stops_.size());
+	std::vector<domain::Stop*> symbol_to_stop;
+	for (domain::Stop& stop : stops_) {
+		const SymbolId name_id = names.Intern(stop.stop_name);
+		stop.stop_name = names.GetName(name_id);
+		symbol_to_stop.resize(std::max<size_t>(symbol_to_stop.size(), name_id + 1), nullptr);
+		symbol_to_stop[name_id] = &stop;
+		stop_store.Add(name_id, stop_store_.GetCoordinates(old_ids[stop.id]));
+	}
+	std::vector<domain::Bus*> symbol_to_bus;
+	for (domain::Bus& bus : buses_) {
+		const SymbolId name_id = names.Intern(bus.bus_name);
+		bus.bus_name = names.GetName(name_id);
+		bus.name_id = name_id;
+		symbol_to_bus.resize(std::max<size_t>(symbol_to_bus.size(), name_id + 1), nullptr);
+		symbol_to_bus[name_id] = &bus;
+	}
+	names_ = std::move(names);
+	stop_store_ = std::move(stop_store);
+	symbol_to_stop_ = std::move(symbol_to_stop);
+	symbol_to_bus_ = std::move(symbol_to_bus);
+}
+
+void TransportCatalogue::SetBusInfo(const domain::BusInfo& bus_info) {
+	CheckNotFrozen();
+	buses_info_[bus_info.bus->id] = bus_info;
+	is_bus_info_dirty_[bus_info.bus->id] = false;
+}
+
+void TransportCatalogue::Finalize() {
+	if (spatial_index_.GetSize() != stops_.size()) {
+		spatial_index_ = SpatialIndex::Build(stop_store_.GetSpherePoints());
 	}
+	BuildStopToBuses();
+	SetBusesInfo();
+}
+
+void TransportCatalogue::Freeze() {
+	// a loaded base interns stops and then buses, so names added in another order,
+	// e.g. by streamed input with buses between stops, are interned anew to keep
+	// the stored index matching the symbol ids after loading; names streamed without
+	// a reserve span several blocks and are packed into one the same way
+	if (!HasLoadOrderNames() || !names_.IsContiguous()) {
+		std::vector<uint32_t> ids(stops_.size());
+		std::iota(ids.begin(), ids.end(), 0);
+		RebuildNamesAndStopStore(ids);
+	}
+	std::vector<std::string_view> names;
+	names.reserve(names_.GetSymbolCount());
+	for (SymbolId id = 0; id < names_.GetSymbolCount(); ++id) {
+		names.push_back(names_.GetName(id));
+	}
+	name_index_ = PerfectHash::Build(names);
+	is_frozen_ = true;
+}
+
+void TransportCatalogue::Freeze(PerfectHash::Data name_index) {
+	// tables of other sizes would make lookups divide by zero or read past the end
+	if (name_index.values.size() != names_.GetSymbolCount()
+		|| name_index.fingerprints.size() != name_index.values.size()
+		|| (!name_index.values.empty() && name_index.pilots.empty())) {
+		Freeze();
+		return;
+	}
+	name_index_ = PerfectHash(std::move(name_index));
+	for (SymbolId id = 0; id < names_.GetSymbolCount(); ++id) {
+		if (name_index_.Find(names_.GetName(id)) != id) {
+			Freeze();
+			return;
+		}
+	}
+	is_frozen_ = true;
+}
+
+bool TransportCatalogue::IsFrozen() const {
+	return is_frozen_;
+}
+
+const PerfectHash& TransportCatalogue::GetNameIndex() const {
+	return name_index_;
 }
 
 TransportCatalogue::AllBusesInfo TransportCatalogue::GetAllBusesInfo() const {
@@ -102,6 +363,35 @@ TransportCatalogue::AllStops TransportCatalogue::GetAllStops() const {
 	return stops_;
 }
 
+const StopStore& TransportCatalogue::GetStopStore() const {
+	return stop_store_;
+}
+
+void TransportCatalogue::SetSpatialIndex(std::vector<uint32_t> order) {
+	// a stored index is accepted only if its tree holds for the current coordinates,
+	// otherwise the index stays empty and Finalize builds a new one
+	SpatialIndex spatial_index(std::move(order));
+	if (spatial_index.IsValidFor(stop_store_.GetSpherePoints())) {
+		spatial_index_ = std::move(spatial_index);
+	} else {
+		spatial_index_ = {};
+	}
+}
+
+const SpatialIndex& TransportCatalogue::GetSpatialIndex() const {
+	return spatial_index_;
+}
+
+std::vector<domain::StopDistance> TransportCatalogue::FindNearestStops(geo::Coordinates point,
+																	   size_t count) const {
+	return MakeStopDistances(spatial_index_.FindNearest(stop_store_.GetSpherePoints(), point, count));
+}
+
+std::vector<domain::StopDistance> TransportCatalogue::FindStopsInRadius(geo::Coordinates point,
+																		double radius) const {
+	return MakeStopDistances(spatial_index_.FindInRadius(stop_store_.GetSpherePoints(), point, radius));
+}
+
 size_t TransportCatalogue::GetStopCounts() const {
 	return stops_.size();
 }
@@ -110,6 +400,24 @@ size_t TransportCatalogue::GetBusCounts() const {
 	return buses_.size();
 }
 
+std::optional<SymbolId> TransportCatalogue::FindSymbol(std::string_view name) const {
+	if (!is_frozen_) {
+		return names_.Find(name);
+	}
+	const auto name_id = name_index_.Find(name);
+	if (!name_id || names_.GetName(*name_id) != name) {
+		return std::nullopt;
+	}
+	return name_id;
+}
+
+void TransportCatalogue::CheckNotFrozen() const {
+	using namespace std::literals;
+	if (is_frozen_) {
+		throw std::logic_error("Catalogue is frozen"s);
+	}
+}
+
 double TransportCatalogue::GetDistance(const domain::Stop* stop_from,
 												 const domain::Stop* stop_to) const {
 
@@ -117,9 +425,8 @@ double TransportCatalogue::GetDistance(const domain::Stop* stop_from,
 	return dist_val > 0 ? dist_val : GetDistanceFromTo(stop_to, stop_from);;
 }
 
-const TransportCatalogue::Distances* TransportCatalogue::GetAllDistances() {
-	Distances* dist_ptr = &distances_;
-	return dist_ptr;
+const TransportCatalogue::Distances* TransportCatalogue::GetAllDistances() const {
+	return &distances_;
 }
 
 double TransportCatalogue::GetDistanceForPairStops(const domain::Stop *from,
@@ -133,38 +440,50 @@ double TransportCatalogue::GetDistanceForPairStops(const domain::Stop *from,
 
 size_t TransportCatalogue::GetDistanceFromTo(const domain::Stop* from,
 											 const domain::Stop* to) const {
-	if (distances_.count({from, to}) > 0) {
-		return distances_.at({from, to});
+	const auto it = distances_.find({from, to});
+	if (it != distances_.end()) {
+		return it->second;
     }
     return {};
 }
 
 TransportCatalogue::StopCount
-TransportCatalogue::GetStopCount (const domain::Bus* bus) const{
+TransportCatalogue::GetStopCount (const domain::Bus* bus, std::vector<bool>& is_seen) const{
 	StopCount output {};
 	bool is_ring_route = bus->route_type == domain::RouteType::Ring;
+	const Route route = GetRoute(*bus);
 	output.stop_count = is_ring_route ?
-				bus->route_.size() : bus->route_.size() * 2 - 1;
-	std::unordered_set<const domain::Stop*> unique_stops;
-	unique_stops.insert(bus->route_.begin(), bus->route_.end());
-	output.unique_stops = unique_stops.size();
+				route.size() : route.size() * 2 - 1;
+	for (const uint32_t stop_id : route) {
+		if (!is_seen[stop_id]) {
+			is_seen[stop_id] = true;
+			++output.unique_stops;
+		}
+	}
+	for (const uint32_t stop_id : route) {
+		is_seen[stop_id] = false;
+	}
 	return output;
 }
 
 double TransportCatalogue::GetRealRouteLength (const domain::Bus* bus) const {
+	const Route route = GetRoute(*bus);
+	auto stop = [this, &route](size_t index) {
+		return &stops_[route[index]];
+	};
     double length = 0;
-    for (size_t i = 1; i < bus->route_.size(); ++i) {
-		length += GetDistance(bus->route_[i - 1], bus->route_[i]);
+    for (size_t i = 1; i < route.size(); ++i) {
+		length += GetDistance(stop(i - 1), stop(i));
 	}
 	if (bus->route_type == domain::RouteType::Ring) {
 		return length;
 	} else {
-		for (int i = bus->route_.size(); i > 1; --i) {
-			length += GetDistance(bus->route_[i - 1], bus->route_[i - 2]);
+		for (int i = route.size(); i > 1; --i) {
+			length += GetDistance(stop(i - 1), stop(i - 2));
 		}
 		double check_last_stop =
-				GetDistance(bus->route_[bus->route_.size() - 1],
-							bus->route_[bus->route_.size() - 1]);
+				GetDistance(stop(route.size() - 1),
+							stop(route.size() - 1));
 		if (check_last_stop > 0) {
 			length += check_last_stop;
 		}
@@ -173,21 +492,18 @@ double TransportCatalogue::GetRealRouteLength (const domain::Bus* bus) const {
 }
 
 double TransportCatalogue::GetGeoRouteLength (const domain::Bus* bus) const {
-	double length = 0;
-	for (size_t i = 1; i < bus->route_.size(); ++i) {
-		length += (ComputeDistance(bus->route_[i - 1]->coordinates,
-				   bus->route_[i]->coordinates));
-	}
+	const Route route = GetRoute(*bus);
+	double length = geo::ComputePathLength(stop_store_.GetSpherePoints(), route.begin(), route.size());
 	if (bus->route_type == domain::RouteType::Line) {
 		length *= 2.;
 	}
 	return length;
 }
 
-void TransportCatalogue::MakeBusInfo(const domain::Bus* bus) {
+domain::BusInfo TransportCatalogue::MakeBusInfo(const domain::Bus* bus, std::vector<bool>& is_seen) const {
 	domain::BusInfo bus_info {};
 	bus_info.bus = bus;
-	StopCount stop_count = GetStopCount(bus);
+	StopCount stop_count = GetStopCount(bus, is_seen);
 	bus_info.count_stops = stop_count.stop_count;
 	bus_info.unique_stops = stop_count.unique_stops;
 	if (bus_info.count_stops > 1) {
@@ -198,6 +514,77 @@ void TransportCatalogue::MakeBusInfo(const domain::Bus* bus) {
 		bus_info.geo_length = 0;
 		bus_info.real_length = GetRealRouteLength(bus);
 	}
-	buses_info_.insert({bus->bus_name, std::move(bus_info)});
+	return bus_info;
+}
+
+void TransportCatalogue::MarkBusesInfoDirty(const domain::Stop* stop) {
+	// before the first Finalize the stop-to-buses index is not built yet,
+	// but then no bus info has been computed either
+	if (stop_to_buses_offsets_.empty()) {
+		return;
+	}
+	// buses added after Finalize are not in the index yet
+	if (is_stop_to_buses_stale_) {
+		BuildStopToBuses();
+	}
+	if (stop->id + 1 >= stop_to_buses_offsets_.size()) {
+		return;
+	}
+	for (uint32_t i = stop_to_buses_offsets_[stop->id]; i < stop_to_buses_offsets_[stop->id + 1]; ++i) {
+		is_bus_info_dirty_[stop_to_buses_[i]] = true;
+	}
+}
+
+std::vector<domain::StopDistance>
+TransportCatalogue::MakeStopDistances(const std::vector<SpatialIndex::Neighbour>& neighbours) const {
+	std::vector<domain::StopDistance> output;
+	output.reserve(neighbours.size());
+	for (const SpatialIndex::Neighbour& neighbour : neighbours) {
+		output.push_back({&stops_[neighbour.id], neighbour.distance});
+	}
+	return output;
+}
+
+void TransportCatalogue::BuildStopToBuses() {
+	// buses are visited in name order, so every per-stop list comes out sorted
+	std::vector<const domain::Bus*> sorted_buses;
+	sorted_buses.reserve(buses_.size());
+	for (const domain::Bus& bus : buses_) {
+		sorted_buses.push_back(&bus);
+	}
+	std::sort(sorted_buses.begin(), sorted_buses.end(),
+			  [](const domain::Bus* lhs, const domain::Bus* rhs) {
+		return lhs->bus_name < rhs->bus_name;
+	});
+
+	// last_bus[stop_id] keeps the last bus counted for the stop,
+	// so a bus visiting the same stop several times is counted once
+	constexpr uint32_t kNoBus = UINT32_MAX;
+	std::vector<uint32_t> last_bus(stops_.size(), kNoBus);
+	stop_to_buses_offsets_.assign(stops_.size() + 1, 0);
+	is_stop_to_buses_stale_ = false;
+	for (const domain::Bus* bus : sorted_buses) {
+		for (const uint32_t stop_id : GetRoute(*bus)) {
+			if (last_bus[stop_id] != bus->id) {
+				last_bus[stop_id] = bus->id;
+				++stop_to_buses_offsets_[stop_id + 1];
+			}
+		}
+	}
+	for (size_t i = 1; i < stop_to_buses_offsets_.size(); ++i) {
+		stop_to_buses_offsets_[i] += stop_to_buses_offsets_[i - 1];
+	}
+
+	stop_to_buses_.assign(stop_to_buses_offsets_.back(), kNoBus);
+	std::vector<uint32_t> fill_pos(stop_to_buses_offsets_.begin(), stop_to_buses_offsets_.end() - 1);
+	std::fill(last_bus.begin(), last_bus.end(), kNoBus);
+	for (const domain::Bus* bus : sorted_buses) {
+		for (const uint32_t stop_id : GetRoute(*bus)) {
+			if (last_bus[stop_id] != bus->id) {
+				last_bus[stop_id] = bus->id;
+				stop_to_buses_[fill_pos[stop_id]++] = bus->id;
+			}
+		}
+	}
 }
 } // namespace data_base
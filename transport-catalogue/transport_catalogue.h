@@ -1,12 +1,19 @@
 #pragma once
 #include "domain.h"
+#include "perfect_hash.h"
+#include "ranges.h"
+#include "spatial_index.h"
+#include "stop_store.h"
+#include "string_arena.h"
+
 #include <algorithm>
+#include <cstdint>
 #include <deque>
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
-#include <unordered_set>
 #include <unordered_map>
 #include <vector>
 
@@ -38,51 +45,131 @@ class TransportCatalogue {
 public:
 	using AllStops = std::deque<domain::Stop>;
 	using AllBuses = std::deque<domain::Bus>;
-	using AllBusesInfo = std::unordered_map<std::string_view, domain::BusInfo>;
+	// info of the bus with id N is element N, bus is null for buses without stops
+	using AllBusesInfo = std::vector<domain::BusInfo>;
 	using FromTo = std::pair<const domain::Stop*, const domain::Stop*>;
-	using Buses = std::unordered_set<domain::Bus*>;
+	using BusIds = std::vector<uint32_t>;
+	using Route = ranges::Range<const uint32_t*>;
 	using Distances = std::unordered_map<FromTo, double, detail::StopHasher>;
 
 	TransportCatalogue();
+	TransportCatalogue(const TransportCatalogue&) = delete;
+	TransportCatalogue& operator=(const TransportCatalogue&) = delete;
+	TransportCatalogue(TransportCatalogue&&) = default;
+	TransportCatalogue& operator=(TransportCatalogue&&) = default;
+
+	// reserves space for total_size bytes of stop and bus names
+	void ReserveNames(size_t total_size);
+	void ReserveStops(size_t count);
+	void ReserveBuses(size_t count, size_t route_stop_count);
+	void ReserveDistances(size_t count);
 
-	void AddStop(const domain::Stop& stop);
-	void AddBus(const domain::Bus& bus);
+	void AddStop(const domain::Stop& stop, geo::Coordinates coordinates);
+	void AddBus(const domain::Bus& bus, const std::vector<domain::Stop*>& route);
+	// route is given by stop ids, e.g. straight from a loaded base
+	void AddBus(const domain::Bus& bus, Route route);
 
 	domain::Stop* FindStop(std::string_view stop_name) const;
-	domain::Stop* FindStopById(size_t id);
+	const domain::Stop* FindStopById(size_t id) const;
 	domain::Bus* FindBus(std::string_view bus_name) const;
 
+	// ids of the bus stops in the order of the route
+	Route GetRoute(const domain::Bus& bus) const;
+
 	domain::BusInfo GetBusInfo(std::string_view bus_name) const;
+	domain::BusInfo GetBusInfo(const domain::Bus& bus) const;
 	domain::StopInfo GetStopInfo(std::string_view stop_name) const;
+	domain::StopInfo GetStopInfo(const domain::Stop& stop) const;
+	// stop or bus name by the symbol id kept in buses, stop infos and graph edges
+	std::string_view GetName(SymbolId id) const;
 
+	// a later distance between the same stops in the same direction replaces the earlier one;
+	// before Finalize it touches only the distance table, so it may run on another thread
+	// than AddBus and SetBusInfo once all stops are added
 	void SetDistances (std::string_view from, std::string_view to, double dist);
+	void SetDistances (const domain::Stop* from, const domain::Stop* to, double dist);
+	// computes info for the buses added or touched by SetDistances since the last call,
+	// in parallel when there are enough of them
 	void SetBusesInfo();
+	// sets precomputed info of bus_info.bus, which is then not recomputed
+	void SetBusInfo(const domain::BusInfo& bus_info);
+
+	// renumbers stops so that the stop with id order[N] gets id N;
+	// must be called before Finalize
+	void ReorderStops(const std::vector<uint32_t>& order);
+
+	// must be called after the last AddBus: builds stop-to-buses index
+	// and brings info of all buses up to date
+	void Finalize();
+
+	// makes the catalogue read-only and switches name lookups to a minimal perfect hash;
+	// a stored index is reused when it covers the same set of names and its tables
+	// are consistent, otherwise the index is built anew
+	void Freeze();
+	void Freeze(PerfectHash::Data name_index);
+	bool IsFrozen() const;
+	const PerfectHash& GetNameIndex() const;
 
 	AllBusesInfo GetAllBusesInfo() const;
 	AllBuses GetAllBuses() const;
 	AllStops GetAllStops() const;
 
+	const StopStore& GetStopStore() const;
+
+	// spatial index over stops is built by Finalize unless a stored one is set before;
+	// a stored order whose tree does not hold for the stop coordinates is dropped
+	void SetSpatialIndex(std::vector<uint32_t> order);
+	const SpatialIndex& GetSpatialIndex() const;
+	std::vector<domain::StopDistance> FindNearestStops(geo::Coordinates point, size_t count) const;
+	std::vector<domain::StopDistance> FindStopsInRadius(geo::Coordinates point, double radius) const;
+
 	size_t GetStopCounts() const;
 	size_t GetBusCounts() const;
 
-	const Distances* GetAllDistances();
+	const Distances* GetAllDistances() const;
 	double GetDistanceForPairStops(const domain::Stop *from, const domain::Stop *to) const;
 
 private:
 	AllStops stops_ {};
 	AllBuses buses_ {};
-	std::unordered_map<std::string_view, domain::Stop*> stopname_to_stop_ {};
-	std::unordered_map<std::string_view, domain::Bus*> busname_to_bus_ {};
-	std::unordered_map<domain::Stop*, Buses> stop_to_buses_ {};
+	StopStore stop_store_ {};
+	// route stop ids of all buses, one slice per bus
+	std::vector<uint32_t> routes_ {};
+	StringArena names_ {};
+	SpatialIndex spatial_index_ {};
+	// stops and buses by symbol id of their names
+	std::vector<domain::Stop*> symbol_to_stop_ {};
+	std::vector<domain::Bus*> symbol_to_bus_ {};
+	PerfectHash name_index_ {};
+	bool is_frozen_ = false;
+	// stop-to-buses incidence in compressed form (CSR): bus ids passing through
+	// the stop with id N are stop_to_buses_[stop_to_buses_offsets_[N] .. stop_to_buses_offsets_[N + 1]),
+	// sorted by bus name
+	std::vector<uint32_t> stop_to_buses_offsets_ {};
+	BusIds stop_to_buses_ {};
+	// a bus was added after the index was built; GetStopInfo misses it until Finalize,
+	// MarkBusesInfoDirty rebuilds the index first
+	bool is_stop_to_buses_stale_ = false;
 	Distances distances_ {};
 	AllBusesInfo buses_info_ {};
+	// buses whose info must be recomputed by SetBusesInfo
+	std::vector<bool> is_bus_info_dirty_ {};
 
+	std::optional<SymbolId> FindSymbol(std::string_view name) const;
+	void CheckNotFrozen() const;
 	double GetDistance (const domain::Stop* stop_from, const domain::Stop* stop_to) const;
 	size_t GetDistanceFromTo(const domain::Stop* from,
 							 const domain::Stop* to) const;
-	StopCount GetStopCount (const domain::Bus* bus) const;
+	// is_seen is a scratch bitset over stop ids, all clear on entry and on return
+	StopCount GetStopCount (const domain::Bus* bus, std::vector<bool>& is_seen) const;
 	double GetRealRouteLength (const domain::Bus* bus) const;
 	double GetGeoRouteLength (const domain::Bus* bus) const;
-	void MakeBusInfo(const domain::Bus* bus);
+	domain::BusInfo MakeBusInfo(const domain::Bus* bus, std::vector<bool>& is_seen) const;
+	void MarkBusesInfoDirty(const domain::Stop* stop);
+	bool HasLoadOrderNames() const;
+	// the stop with id N takes the coordinates of the stop store entry old_ids[N]
+	void RebuildNamesAndStopStore(const std::vector<uint32_t>& old_ids);
+	void BuildStopToBuses();
+	std::vector<domain::StopDistance> MakeStopDistances(const std::vector<SpatialIndex::Neighbour>& neighbours) const;
 };
 }  // namespace data_base
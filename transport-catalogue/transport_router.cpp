@@ -1,6 +1,12 @@
 #include "transport_router.h"
+#include "content_hash.h"
+
+#include <algorithm>
 #include <iostream>
 #include <ostream>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 
 namespace router {
@@ -13,6 +19,20 @@ void TransportRouter::SetVelocity(double bus_velocity) {
 	bus_velocity_ = bus_velocity;
 }
 
+void TransportRouter::SetWalkingSettings(const double walking_speed, const double max_distance) {
+	walking_speed_ = walking_speed;
+	max_walking_distance_ = max_distance;
+}
+
+void TransportRouter::SetMaxWalkingEdges(const size_t max_edges) {
+	max_walking_edges_ = max_edges;
+}
+
+double TransportRouter::GetWalkingWeightValue(double distance) {
+	double distance_km = distance / kMetersInKm;
+	return (distance_km / walking_speed_) * kMinInHour;
+}
+
 double TransportRouter::GetDistanceWeightValue(double distance) {
 	double distance_km = distance / kMetersInKm;
 	return (distance_km / bus_velocity_) * kMinInHour;
@@ -23,22 +43,23 @@ void TransportRouter::FillGraphForPair (graph::DirectedWeightedGraph<double>& gr
 										size_t stop_from_id,
 										size_t stop_to_id,
 										size_t span_count,
-										std::string_view bus_name) {
-	graph::Edge<double> edge {stop_from_id, stop_to_id, weight, span_count, static_cast<std::string>(bus_name)};
+										data_base::SymbolId bus_name_id) {
+	graph::Edge<double> edge {stop_from_id, stop_to_id, weight, span_count, bus_name_id};
 	graph.AddEdge(std::move(edge));
 }
 
 void TransportRouter::FillGraphForForwardDirect(std::unique_ptr<data_base::TransportCatalogue>& tc,
 												graph::DirectedWeightedGraph<double>& graph,
-												const std::vector<domain::Stop*>& stops,
-												std::string_view bus_name) {
+												data_base::TransportCatalogue::Route stops,
+												data_base::SymbolId bus_name_id) {
 	for (size_t i = 0; i < stops.size() - 1; ++i) {
 		double weight = bus_wait_time_;
 		size_t span_count = 1;
 		for (size_t j = i + 1; j < stops.size(); ++j) {
             if (stops[i] != stops[j]) {
-                weight += GetDistanceWeightValue(tc->GetDistanceForPairStops(stops[j - 1], stops [j]));
-				FillGraphForPair(graph, weight, stops[i]->id, stops[j]->id, span_count, bus_name);
+                weight += GetDistanceWeightValue(tc->GetDistanceForPairStops(tc->FindStopById(stops[j - 1]),
+                                                                             tc->FindStopById(stops[j])));
+				FillGraphForPair(graph, weight, stops[i], stops[j], span_count, bus_name_id);
 				++span_count;
 			}
 		}
@@ -47,15 +68,16 @@ void TransportRouter::FillGraphForForwardDirect(std::unique_ptr<data_base::Trans
 
 void TransportRouter::FillGraphForReverseDirect(std::unique_ptr<data_base::TransportCatalogue> &tc,
                                                 graph::DirectedWeightedGraph<double> &graph,
-                                                const std::vector<domain::Stop*>& stops,
-                                                std::string_view bus_name) {
+                                                data_base::TransportCatalogue::Route stops,
+                                                data_base::SymbolId bus_name_id) {
 	for (size_t i = stops.size() - 1; i > 0; --i) {
 		double weight = bus_wait_time_;
 		size_t span_count = 1;
 		for (size_t j = i; j > 0; --j) {
             if (stops[i] != stops[j - 1]) {
-                weight += GetDistanceWeightValue(tc->GetDistanceForPairStops(stops[j], stops [j - 1]));
-				FillGraphForPair(graph, weight, stops[i]->id, stops[j - 1]->id, span_count, bus_name);
+                weight += GetDistanceWeightValue(tc->GetDistanceForPairStops(tc->FindStopById(stops[j]),
+                                                                             tc->FindStopById(stops[j - 1])));
+				FillGraphForPair(graph, weight, stops[i], stops[j - 1], span_count, bus_name_id);
 				++span_count;
 			}
 		}
@@ -67,12 +89,66 @@ void TransportRouter::FillGraph(std::unique_ptr<data_base::TransportCatalogue>&
 	// fill a graph for each pair stops from bus route
     // one stop - one pair of vertexes: (from, to)
     for (const auto& bus : tc->GetAllBuses()) {
-		const std::vector<domain::Stop*>& route_stops = bus.route_;
-		FillGraphForForwardDirect(tc, graph, route_stops, bus.bus_name);
+		const data_base::TransportCatalogue::Route route_stops = tc->GetRoute(bus);
+		FillGraphForForwardDirect(tc, graph, route_stops, bus.name_id);
 		if (bus.route_type == domain::RouteType::Line) {
-			FillGraphForReverseDirect(tc, graph, route_stops, bus.bus_name);
+			FillGraphForReverseDirect(tc, graph, route_stops, bus.name_id);
 		}
 	}
+	FillGraphWithWalkingEdges(tc, graph);
+}
+
+void TransportRouter::FillGraphWithWalkingEdges(std::unique_ptr<data_base::TransportCatalogue>& tc,
+												graph::DirectedWeightedGraph<double>& graph) {
+	if (walking_speed_ <= 0 || max_walking_distance_ <= 0 || max_walking_edges_ == 0) {
+		return;
+	}
+	// every stop is linked with its nearest neighbours found by the spatial index,
+	// so the pass is O(n log n). Being a neighbour is not mutual, so each found pair
+	// is walked both ways and counts against both stops; pairs are accepted from
+	// the shortest one while both stops have less than max_walking_edges_ of them
+	const data_base::StopStore& stop_store = tc->GetStopStore();
+	std::vector<std::tuple<double, size_t, size_t>> walks;
+	for (size_t stop_id = 0; stop_id < tc->GetStopCounts(); ++stop_id) {
+		// one extra neighbour for the stop itself, which is not necessarily the first
+		// one when several stops share coordinates
+		const auto neighbours = tc->FindNearestStops(stop_store.GetCoordinates(stop_id), max_walking_edges_ + 1);
+		size_t edge_count = 0;
+		for (const domain::StopDistance& neighbour : neighbours) {
+			if (neighbour.distance > max_walking_distance_ || edge_count == max_walking_edges_) {
+				break;
+			}
+			if (neighbour.stop->id == stop_id) {
+				continue;
+			}
+			++edge_count;
+			const size_t from = std::min(stop_id, neighbour.stop->id);
+			const size_t to = std::max(stop_id, neighbour.stop->id);
+			walks.emplace_back(geo::ComputeDistance(stop_store.GetCoordinates(from), stop_store.GetCoordinates(to)),
+							   from, to);
+		}
+	}
+	std::sort(walks.begin(), walks.end());
+	walks.erase(std::unique(walks.begin(), walks.end()), walks.end());
+	std::vector<size_t> degrees(tc->GetStopCounts(), 0);
+	for (const auto& [distance, from, to] : walks) {
+		if (degrees[from] == max_walking_edges_ || degrees[to] == max_walking_edges_) {
+			continue;
+		}
+		++degrees[from];
+		++degrees[to];
+		const double weight = GetWalkingWeightValue(distance);
+		graph.AddEdge({from, to, weight, 0, {}, graph::EdgeType::Walk});
+		graph.AddEdge({to, from, weight, 0, {}, graph::EdgeType::Walk});
+	}
+}
+
+uint64_t TransportRouter::GetSettingsHash() const {
+	return content_hash::Hasher{}
+		.AddValue(bus_wait_time_).AddValue(bus_velocity_)
+		.AddValue(walking_speed_).AddValue(max_walking_distance_)
+		.AddValue(static_cast<uint64_t>(max_walking_edges_))
+		.GetHash();
 }
 
 double TransportRouter::GetBusWaitTime() {
@@ -10,37 +10,51 @@ public:
 
 	void SetWaitTime(const double bus_wait_time);
 	void SetVelocity(const double bus_velocity);
+	// walking transfers between stops not farther than max_distance meters,
+	// disabled while speed or distance is zero
+	void SetWalkingSettings(const double walking_speed, const double max_distance);
+	void SetMaxWalkingEdges(const size_t max_edges);
 
     void FillGraph(std::unique_ptr<data_base::TransportCatalogue>& tc,
                    graph::DirectedWeightedGraph<double>& graph);
 
 	double GetBusWaitTime();
+	// changes whenever a setting affecting the graph changes
+	uint64_t GetSettingsHash() const;
 
 private:
 	double bus_wait_time_;
 	double bus_velocity_;
+	double walking_speed_ = 0;
+	double max_walking_distance_ = 0;
+	size_t max_walking_edges_ = kDefaultWalkingEdges;
 	graph::Router<double>* graph_;
 	static constexpr double kMetersInKm = 1000;
 	static constexpr double kMinInHour = 60;
+	static constexpr size_t kDefaultWalkingEdges = 5;
 
 	double GetDistanceWeightValue(double distance);
+	double GetWalkingWeightValue(double distance);
+
+	void FillGraphWithWalkingEdges(std::unique_ptr<data_base::TransportCatalogue>& tc,
+								   graph::DirectedWeightedGraph<double>& graph);
 
 	void FillGraphForPair (graph::DirectedWeightedGraph<double>& graph,
 						   double weight,
 						   size_t i,
 						   size_t j,
 						   size_t span_count,
-						   std::string_view bus_num);
+						   data_base::SymbolId bus_name_id);
 
     void FillGraphForForwardDirect(std::unique_ptr<data_base::TransportCatalogue>& tc,
 								   graph::DirectedWeightedGraph<double> &graph,
-								   const std::vector<domain::Stop*>& stops,
-								   std::string_view bus_name);
+								   data_base::TransportCatalogue::Route stops,
+								   data_base::SymbolId bus_name_id);
 
     void FillGraphForReverseDirect(std::unique_ptr<data_base::TransportCatalogue>& tc,
 								   graph::DirectedWeightedGraph<double> &graph,
-								   const std::vector<domain::Stop*>& stops,
-								   std::string_view bus_name);
+								   data_base::TransportCatalogue::Route stops,
+								   data_base::SymbolId bus_name_id);
 };
 
 } // namespace router